@@ -0,0 +1,649 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Algorithms.h"
+#include "Array.h"
+#include "Divider.h"
+#include "Timer.h"
+#include "ValuePack.h"
+
+// Microbenchmarks of the ValuePack operations against the equivalent scalar code.
+//
+//	Benchmark [--filter text] [--json file]
+//
+// Every operation is timed twice: as one dependent chain, 'x = op(x, c)', which measures latency, and as several
+// independent chains, which measures throughput. Times are reported per element, so an operation that takes as long
+// per pack as the scalar code takes per element is PackSize times faster.
+// Math functions and reductions would leave their domain when iterated, so they are chained as 'x + f(x) * 0' instead,
+// which adds a multiply and an add to both the pack and the scalar time.
+// Each step ends in an optimization barrier, so the compiler can neither fold a chain into fewer steps nor vectorize
+// the scalar chains. Operations with no scalar equivalent (permutes) have no baseline. Conversions, memory operations,
+// divisions by a Divider and the simd:: algorithms are timed over a buffer, in throughput mode only.
+// Cycles are TSC reference cycles, which tick at the nominal frequency rather than the current one.
+
+#define BENCH_STRINGIFY2(x) #x
+#define BENCH_STRINGIFY(x) BENCH_STRINGIFY2(x)
+
+namespace
+{
+	// Independent chains in throughput mode, enough to hide the latency of most instructions
+	constexpr size_t Chains = 8;
+	// Chain steps per timed iteration
+	constexpr size_t Steps = 64;
+	// Each operation is timed this many times, keeping the fastest
+	constexpr int Samples = 5;
+	constexpr auto MinSampleTime = std::chrono::microseconds(200);
+	// Elements per pass of a buffer benchmark, small enough for the input and output buffers to stay in L1
+	constexpr size_t BufferElems = 1024;
+
+	struct Timing
+	{
+		double ns = 0.0;
+		double cycles = 0.0;
+	};
+
+	struct Result
+	{
+		std::string name;
+		std::string_view type;
+		size_t bits;
+		std::string_view mode;
+		Timing pack;
+		Timing scalar;
+		bool hasScalar;
+	};
+
+	template <typename T>
+	constexpr std::string_view TypeName()
+	{
+		if constexpr (std::is_same_v<T, float>) return "float";
+		else if constexpr (std::is_same_v<T, double>) return "double";
+		else if constexpr (std::is_same_v<T, int8_t>) return "int8";
+		else if constexpr (std::is_same_v<T, uint8_t>) return "uint8";
+		else if constexpr (std::is_same_v<T, int16_t>) return "int16";
+		else if constexpr (std::is_same_v<T, uint16_t>) return "uint16";
+		else if constexpr (std::is_same_v<T, int32_t>) return "int32";
+		else if constexpr (std::is_same_v<T, uint32_t>) return "uint32";
+		else if constexpr (std::is_same_v<T, int64_t>) return "int64";
+		else return "uint64";
+	}
+
+	// Every consumed value is written here, so its computation can't be optimized away
+	volatile unsigned char sink[64];
+
+	template <typename T>
+	void Consume(T value)
+	{
+		static_assert(sizeof(T) <= sizeof(sink), "Consumed value larger than the sink");
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+		for (size_t i = 0; i < sizeof(T); i++)
+			sink[i] = bytes[i];
+	}
+
+	// Makes the compiler forget the value of 'value', so chains of steps can't be folded into fewer operations.
+	// MSVC has no inline assembly for x64, so there chains are only kept apart by their opaque inputs
+	template <typename T>
+	void Barrier(T& value)
+	{
+#if defined(__GNUC__)
+		if constexpr (std::is_integral_v<T>) asm volatile("" : "+r"(value));
+		else asm volatile("" : "+v"(value));
+#endif
+	}
+
+	template <typename T, size_t PackSize>
+	void Barrier(ValuePack<T, PackSize>& value)
+	{
+		Barrier(value.pack);
+	}
+
+	// 'value' read back through a volatile, so the compiler can't fold a chain on a known input
+	template <typename T>
+	T Opaque(T value)
+	{
+		volatile T copy = value;
+		return copy;
+	}
+
+	// Inputs in (0, 1) for floating point, which is in the domain of most math functions, and small integers
+	template <typename T>
+	T InitialValue(size_t i)
+	{
+		if constexpr (std::is_floating_point_v<T>) return static_cast<T>(0.5 + 0.01 * static_cast<double>(i % 16));
+		else return static_cast<T>(i % 7 + 1);
+	}
+
+	// Calls 'run(iterations)' with enough iterations to time reliably, and returns the fastest time per iteration
+	template <typename Run>
+	Timing Measure(Run&& run)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		size_t iterations = 1;
+		while (true)
+		{
+			Clock::time_point start = Clock::now();
+			run(iterations);
+			if (Clock::now() - start >= MinSampleTime) break;
+			iterations *= 2;
+		}
+
+		Timing best{ std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() };
+		for (int sample = 0; sample < Samples; sample++)
+		{
+			Clock::time_point start = Clock::now();
+			uint64_t startCycles = CycleCounter::Begin();
+			run(iterations);
+			uint64_t cycles = CycleCounter::End() - startCycles;
+			std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+
+			best.ns = std::min(best.ns, elapsed.count() / iterations);
+			best.cycles = std::min(best.cycles, static_cast<double>(cycles) / iterations);
+		}
+		return best;
+	}
+
+	// Time per step of one chain (latency) or of 'Chains' interleaved chains (throughput). 'inits' are loaded from
+	// memory, so the chains can't be merged by the compiler even though they compute the same thing
+	template <typename V, typename Step>
+	Timing MeasureChains(bool latency, const std::array<V, Chains>& inits, V c, Step step)
+	{
+		Timing timing;
+		if (latency)
+		{
+			timing = Measure([&](size_t iterations)
+			{
+				V x = inits[0];
+				for (size_t i = 0; i < iterations; i++)
+					for (size_t s = 0; s < Steps; s++)
+					{
+						x = step(x, c);
+						Barrier(x);
+					}
+				Consume(x);
+			});
+		}
+		else
+		{
+			timing = Measure([&](size_t iterations)
+			{
+				// Chains are unrolled with a fold, a loop over them could leave them in memory
+				[&]<size_t... Is>(std::index_sequence<Is...>)
+				{
+					std::array<V, Chains> x = inits;
+					for (size_t i = 0; i < iterations; i++)
+						for (size_t s = 0; s < Steps; s++)
+							((x[Is] = step(x[Is], c), Barrier(x[Is])), ...);
+					(Consume(x[Is]), ...);
+				}(std::make_index_sequence<Chains>());
+			});
+		}
+		return { timing.ns / Steps, timing.cycles / Steps };
+	}
+
+	class Suite
+	{
+	public:
+		explicit Suite(std::string_view filter_)
+			: filter(filter_) {}
+
+		// Times 'packStep' on ValuePack<T, PackSize> and 'scalarStep' on T, which must compute the same thing per
+		// element. 'scalarStep' may be nullptr
+		template <typename T, size_t PackSize, typename PackStep, typename ScalarStep>
+		void Run(std::string_view name, PackStep packStep, ScalarStep scalarStep)
+		{
+			using Pack = ValuePack<T, PackSize>;
+			constexpr size_t bits = sizeof(T) * PackSize * 8;
+
+			std::string fullName = std::string(name) + "/" + std::string(TypeName<T>()) + "/" + std::to_string(bits);
+			if (fullName.find(filter) == std::string::npos) return;
+
+			std::array<Pack, Chains> packInits;
+			std::array<T, Chains> scalarInits;
+			for (size_t k = 0; k < Chains; k++)
+			{
+				alignas(64) T lanes[PackSize];
+				for (size_t i = 0; i < PackSize; i++)
+					lanes[i] = Opaque(InitialValue<T>(i + k));
+				packInits[k] = Pack::Load(lanes);
+				scalarInits[k] = Opaque(InitialValue<T>(k));
+			}
+			// 1 keeps repeated multiplies away from denormals
+			T c = Opaque(static_cast<T>(1));
+
+			for (bool latency : { true, false })
+			{
+				Result result{ std::string(name), TypeName<T>(), bits, latency ? "latency" : "throughput", {}, {}, false };
+				size_t elemsPerStep = PackSize * (latency ? 1 : Chains);
+
+				Timing pack = MeasureChains(latency, packInits, Pack(c), packStep);
+				result.pack = { pack.ns / elemsPerStep, pack.cycles / elemsPerStep };
+
+				result.hasScalar = !std::is_null_pointer_v<ScalarStep>;
+				if constexpr (!std::is_null_pointer_v<ScalarStep>)
+				{
+					Timing scalar = MeasureChains(latency, scalarInits, c, scalarStep);
+					result.scalar = { scalar.ns / (latency ? 1 : Chains), scalar.cycles / (latency ? 1 : Chains) };
+				}
+
+				Print(result);
+				results.push_back(std::move(result));
+			}
+		}
+
+		// Times 'packPass' against 'scalarPass', which each process 'elems' elements per call and consume their result
+		template <typename T, typename PackPass, typename ScalarPass>
+		void RunPass(std::string_view name, size_t bits, size_t elems, PackPass packPass, ScalarPass scalarPass)
+		{
+			std::string fullName = std::string(name) + "/" + std::string(TypeName<T>()) + "/" + std::to_string(bits);
+			if (fullName.find(filter) == std::string::npos) return;
+
+			Result result{ std::string(name), TypeName<T>(), bits, "throughput", {}, {}, true };
+			Timing pack = Measure([&](size_t iterations)
+			{
+				for (size_t it = 0; it < iterations; it++)
+					packPass();
+			});
+			Timing scalar = Measure([&](size_t iterations)
+			{
+				for (size_t it = 0; it < iterations; it++)
+					scalarPass();
+			});
+			result.pack = { pack.ns / elems, pack.cycles / elems };
+			result.scalar = { scalar.ns / elems, scalar.cycles / elems };
+
+			Print(result);
+			results.push_back(std::move(result));
+		}
+
+		// Times converting a buffer of 'From' to 'To' a pack at a time, against a scalar loop. Conversions only make sense
+		// in throughput mode, as the result can't feed the next conversion.
+		// Float to integer conversions round in packs and truncate in scalar code, at the same cost
+		template <typename From, typename To, size_t PackSize>
+		void RunConvert()
+		{
+			using Pack = ValuePack<From, PackSize>;
+
+			alignas(64) static From in[BufferElems];
+			alignas(64) static To out[BufferElems];
+			for (size_t i = 0; i < BufferElems; i++)
+				in[i] = Opaque(InitialValue<From>(i));
+
+			size_t pass = 0;
+			RunPass<From>("convert_" + std::string(TypeName<To>()), sizeof(From) * PackSize * 8, BufferElems,
+				[&]
+				{
+					for (size_t i = 0; i < BufferElems; i += PackSize)
+						Pack::Load(in + i).template Convert<To>().Store(out + i);
+					Consume(out[pass++ % BufferElems]);
+				},
+				[&]
+				{
+					for (size_t i = 0; i < BufferElems; i++)
+						out[i] = static_cast<To>(in[i]);
+					Consume(out[pass++ % BufferElems]);
+				});
+		}
+
+		static void PrintHeader()
+		{
+			std::cout << std::left << std::setw(32) << "operation" << std::setw(12) << "mode" << std::right
+				<< std::setw(12) << "ns/elem" << std::setw(14) << "cycles/elem" << std::setw(14) << "scalar ns"
+				<< std::setw(10) << "speedup" << '\n';
+		}
+
+		void WriteJson(const std::string& path) const
+		{
+			std::ofstream out(path);
+			out << "{\n";
+			out << "  \"target\": \"" << BENCH_STRINGIFY(WRAPPERSIMD_TARGET) << "\",\n";
+			out << "  \"native_bytes\": " << NativeBytes << ",\n";
+			out << "  \"results\": [\n";
+			for (size_t i = 0; i < results.size(); i++)
+			{
+				const Result& r = results[i];
+				out << "    { \"name\": \"" << r.name << "\", \"type\": \"" << r.type << "\", \"bits\": " << r.bits
+					<< ", \"mode\": \"" << r.mode << "\", \"ns_per_element\": " << r.pack.ns
+					<< ", \"cycles_per_element\": " << r.pack.cycles << ", ";
+				if (r.hasScalar)
+				{
+					out << "\"scalar_ns_per_element\": " << r.scalar.ns << ", \"scalar_cycles_per_element\": " << r.scalar.cycles
+						<< ", \"speedup\": " << r.scalar.ns / r.pack.ns;
+				}
+				else
+				{
+					out << "\"scalar_ns_per_element\": null, \"scalar_cycles_per_element\": null, \"speedup\": null";
+				}
+				out << " }" << (i + 1 < results.size() ? "," : "") << '\n';
+			}
+			out << "  ]\n}\n";
+		}
+
+	protected:
+		static void Print(const Result& r)
+		{
+			std::string label = r.name + "/" + std::string(r.type) + "/" + std::to_string(r.bits);
+			std::cout << std::left << std::setw(32) << label << std::setw(12) << r.mode << std::right << std::fixed
+				<< std::setprecision(3) << std::setw(12) << r.pack.ns << std::setw(14) << r.pack.cycles;
+			if (r.hasScalar)
+				std::cout << std::setw(14) << r.scalar.ns << std::setw(9) << std::setprecision(1) << r.scalar.ns / r.pack.ns << 'x';
+			std::cout << '\n';
+		}
+
+		std::string filter;
+		std::vector<Result> results;
+	};
+
+	// Scalar saturating arithmetic, matching 'adds' and 'subs'
+	template <typename T>
+	T SaturatingAdd(T a, T b)
+	{
+		int64_t sum = static_cast<int64_t>(a) + static_cast<int64_t>(b);
+		return static_cast<T>(std::clamp<int64_t>(sum, std::numeric_limits<T>::min(), std::numeric_limits<T>::max()));
+	}
+
+	template <typename T>
+	T SaturatingSub(T a, T b)
+	{
+		int64_t diff = static_cast<int64_t>(a) - static_cast<int64_t>(b);
+		return static_cast<T>(std::clamp<int64_t>(diff, std::numeric_limits<T>::min(), std::numeric_limits<T>::max()));
+	}
+
+#define BENCH(name, packExpr, scalarExpr) suite.Run<T, PackSize>(name, [&](Pack x, [[maybe_unused]] Pack c) { return packExpr; }, [&](T x, [[maybe_unused]] T c) { return static_cast<T>(scalarExpr); })
+#define BENCH_PACK_ONLY(name, packExpr) suite.Run<T, PackSize>(name, [&](Pack x, [[maybe_unused]] Pack c) { return packExpr; }, nullptr)
+// 'zero' keeps 'x' constant while the next step still depends on 'f(x)'
+#define BENCH_FUNC(name, packExpr, scalarExpr) BENCH(name, x + (packExpr) * zero, x + (scalarExpr) * zero)
+#define BENCH_MATH(func) BENCH_FUNC(#func, func(x), std::func(x))
+
+	template <typename T, size_t PackSize>
+	void BenchPack(Suite& suite)
+	{
+		using Pack = ValuePack<T, PackSize>;
+		using LaneIntTy = std::conditional_t<sizeof(T) == 1, int8_t, std::conditional_t<sizeof(T) == 2, int16_t,
+			std::conditional_t<sizeof(T) == 4, int32_t, int64_t>>>;
+		const T zero = Opaque(static_cast<T>(0));
+
+		// === Arithmetic ===
+		BENCH("add", x + c, x + c);
+		BENCH("sub", x - c, x - c);
+		BENCH("mul", x * c, x * c);
+		if constexpr (std::is_floating_point_v<T>)
+		{
+			BENCH("div", x / c, x / c);
+			BENCH("fma", fma(x, c, c), std::fma(x, c, c));
+			BENCH("fnma", fnma(x, c, c), std::fma(-x, c, c));
+		}
+		if constexpr (std::is_signed_v<T>)
+		{
+			BENCH("neg", -x, -x);
+			BENCH("abs", abs(x - c), std::abs(x - c));
+		}
+		BENCH("min", min(x, c), std::min(x, c));
+		BENCH("max", max(x, c), std::max(x, c));
+		if constexpr (std::is_integral_v<T> && sizeof(T) <= 2)
+		{
+			BENCH("adds", adds(x, c), SaturatingAdd(x, c));
+			BENCH("subs", subs(x, c), SaturatingSub(x, c));
+		}
+		if constexpr (std::is_unsigned_v<T> && sizeof(T) <= 2)
+			BENCH("avg", avg(x, c), (x + c + 1) >> 1);
+
+		// === Bitwise ===
+		if constexpr (std::is_integral_v<T>)
+		{
+			BENCH("and", x & c, x & c);
+			BENCH("or", x | c, x | c);
+			BENCH("xor", x ^ c, x ^ c);
+			BENCH("shl", x << 1, x << 1);
+			BENCH("shr", x >> 1, x >> 1);
+			// Variable shifts need AVX2
+			if constexpr (sizeof(T) >= 4 && WRAPPERSIMD_AVX2)
+			{
+				BENCH("shlv", x << c, x << c);
+				BENCH("shrv", x >> c, x >> c);
+			}
+		}
+
+		// === Comparisons ===
+		BENCH("cmpeq_select", select(x == c, c, x), x == c ? c : x);
+		BENCH("cmpgt_select", select(x > c, c, x), x > c ? c : x);
+
+		// === Math ===
+		if constexpr (std::is_floating_point_v<T>)
+		{
+			BENCH_MATH(sqrt);
+			BENCH_FUNC("invsqrt", invsqrt(x), 1 / std::sqrt(x));
+			// No 512 bit approximation
+			if constexpr (std::is_same_v<T, float> && PackSize < 16)
+				BENCH_FUNC("invsqrt_approx", invsqrt_approx(x), 1 / std::sqrt(x));
+			BENCH_MATH(cbrt);
+			BENCH_FUNC("invcbrt", invcbrt(x), 1 / std::cbrt(x));
+			BENCH_MATH(floor);
+			BENCH_MATH(ceil);
+			BENCH_MATH(round);
+			BENCH_MATH(trunc);
+			BENCH_MATH(rint);
+			BENCH_MATH(sin);
+			BENCH_MATH(cos);
+			BENCH_MATH(tan);
+			BENCH_MATH(asin);
+			BENCH_MATH(acos);
+			BENCH_MATH(atan);
+			BENCH_FUNC("atan2", atan2(x, c), std::atan2(x, c));
+			BENCH_MATH(sinh);
+			BENCH_MATH(cosh);
+			BENCH_MATH(tanh);
+			BENCH_MATH(asinh);
+			BENCH_FUNC("acosh", acosh(x + c), std::acosh(x + c));
+			BENCH_MATH(atanh);
+			BENCH_MATH(exp);
+			BENCH_MATH(log);
+			BENCH_MATH(log2);
+			BENCH_MATH(log10);
+			BENCH_FUNC("pow", pow(x, c), std::pow(x, c));
+			BENCH_MATH(erf);
+		}
+
+		// === Reductions ===
+		// The scalar equivalent of reducing an element is one operation
+		BENCH_FUNC("sum", Pack(static_cast<T>(sum(x))), x + c);
+		BENCH_FUNC("dot", Pack(static_cast<T>(dot(x, c))), x * c + c);
+		BENCH_FUNC("hmin", Pack(hmin(x)), std::min(x, c));
+		BENCH_FUNC("hmax", Pack(hmax(x)), std::max(x, c));
+		BENCH_FUNC("hproduct", Pack(hproduct(x)), x * c);
+
+		// === Conversions ===
+		using WiderTy = std::conditional_t<sizeof(T) == 1, int16_t, std::conditional_t<sizeof(T) == 2, int32_t, int64_t>>;
+		if constexpr (std::is_integral_v<T> && sizeof(T) <= 4 && sizeof(WiderTy) * PackSize <= NativeBytes)
+			suite.RunConvert<T, WiderTy, PackSize>();
+		if constexpr (std::is_same_v<T, float>)
+		{
+			suite.RunConvert<float, int32_t, PackSize>();
+			if constexpr (sizeof(double) * PackSize <= NativeBytes)
+				suite.RunConvert<float, double, PackSize>();
+		}
+
+		// === Memory ===
+		// One pass over a buffer per iteration. Every loaded or stored value goes through a barrier, which keeps the
+		// scalar loops from being vectorized
+		constexpr size_t bits = sizeof(T) * PackSize * 8;
+		alignas(64) static T in[BufferElems + PackSize];
+		alignas(64) static T out[BufferElems + PackSize];
+		for (size_t i = 0; i < BufferElems + PackSize; i++)
+			in[i] = Opaque(InitialValue<T>(i));
+		const T one = Opaque(static_cast<T>(1));
+
+		suite.RunPass<T>("load", bits, BufferElems,
+			[&] { for (size_t i = 0; i < BufferElems; i += PackSize) { Pack v = Pack::Load(in + i); Barrier(v); } },
+			[&] { for (size_t i = 0; i < BufferElems; i++) { T v = in[i]; Barrier(v); } });
+		suite.RunPass<T>("load_unaligned", bits, BufferElems,
+			[&] { for (size_t i = 0; i < BufferElems; i += PackSize) { Pack v = Pack::LoadUnaligned(in + i + 1); Barrier(v); } },
+			[&] { for (size_t i = 0; i < BufferElems; i++) { T v = in[i + 1]; Barrier(v); } });
+		// Loads all but the last element of each pack
+		suite.RunPass<T>("load_partial", bits, BufferElems,
+			[&] { for (size_t i = 0; i < BufferElems; i += PackSize) { Pack v = Pack::LoadPartial(in + i, PackSize - 1); Barrier(v); } },
+			[&]
+			{
+				for (size_t i = 0; i < BufferElems; i += PackSize)
+					for (size_t j = 0; j < PackSize - 1; j++) { T v = in[i + j]; Barrier(v); }
+			});
+		suite.RunPass<T>("store", bits, BufferElems,
+			[&] { Pack v = one; for (size_t i = 0; i < BufferElems; i += PackSize) { Barrier(v); v.Store(out + i); } Consume(out[0]); },
+			[&] { T v = one; for (size_t i = 0; i < BufferElems; i++) { Barrier(v); out[i] = v; } Consume(out[0]); });
+		suite.RunPass<T>("store_stream", bits, BufferElems,
+			[&]
+			{
+				Pack v = one;
+				for (size_t i = 0; i < BufferElems; i += PackSize) { Barrier(v); v.StoreStream(out + i); }
+				_mm_sfence();
+				Consume(out[0]);
+			},
+			[&] { T v = one; for (size_t i = 0; i < BufferElems; i++) { Barrier(v); out[i] = v; } Consume(out[0]); });
+
+		// Gathers and scatters take 32 or 64 bit indices, as many as there are elements
+		if constexpr (sizeof(T) >= 4)
+		{
+			using IndexPack = ValuePack<LaneIntTy, PackSize>;
+			// A fixed permutation of the buffer, spreading neighbouring elements across cache lines
+			alignas(64) static LaneIntTy permutation[BufferElems];
+			for (size_t i = 0; i < BufferElems; i++)
+				permutation[i] = static_cast<LaneIntTy>(i * 97 % BufferElems);
+			suite.RunPass<T>("gather", bits, BufferElems,
+				[&] { for (size_t i = 0; i < BufferElems; i += PackSize) { Pack v = Pack::Gather(in, IndexPack::Load(permutation + i)); Barrier(v); } },
+				[&] { for (size_t i = 0; i < BufferElems; i++) { T v = in[permutation[i]]; Barrier(v); } });
+			suite.RunPass<T>("scatter", bits, BufferElems,
+				[&] { Pack v = one; for (size_t i = 0; i < BufferElems; i += PackSize) { Barrier(v); v.Scatter(out, IndexPack::Load(permutation + i)); } Consume(out[0]); },
+				[&] { T v = one; for (size_t i = 0; i < BufferElems; i++) { Barrier(v); out[permutation[i]] = v; } Consume(out[0]); });
+		}
+
+		// Division by a divisor only known at run time, against the scalar division instruction
+		if constexpr (std::is_integral_v<T>)
+		{
+			const T divisor = Opaque(static_cast<T>(7));
+			Divider<T> divider(divisor);
+			suite.RunPass<T>("div_divider", bits, BufferElems,
+				[&] { for (size_t i = 0; i < BufferElems; i += PackSize) (Pack::Load(in + i) / divider).Store(out + i); Consume(out[0]); },
+				[&] { for (size_t i = 0; i < BufferElems; i++) { T v = in[i]; Barrier(v); out[i] = static_cast<T>(v / divisor); } Consume(out[0]); });
+		}
+
+		// === Permutes ===
+		BENCH_PACK_ONLY("reverse", x.Reverse());
+		BENCH_PACK_ONLY("rotate", x.template Rotate<1>());
+		BENCH_PACK_ONLY("shift_lanes", x.template ShiftLanes<1>());
+		BENCH_PACK_ONLY("broadcast", x.template Broadcast<PackSize - 1>() + c);
+		BENCH_PACK_ONLY("interleave_lo", x.InterleaveLo(c));
+		BENCH_PACK_ONLY("swap_pairs", [&]<size_t... Is>(std::index_sequence<Is...>) { return x.template Permute<(Is ^ 1)...>(); }(std::make_index_sequence<PackSize>()));
+		BENCH_PACK_ONLY("shuffle2_evens", [&]<size_t... Is>(std::index_sequence<Is...>) { return x.template Shuffle2<(2 * Is)...>(c); }(std::make_index_sequence<PackSize>()));
+		BENCH_PACK_ONLY("inclusive_scan", x.InclusiveScan());
+		ValuePack<LaneIntTy, PackSize> indices = ValuePack<LaneIntTy, PackSize>::Range(static_cast<LaneIntTy>(PackSize - 1), static_cast<LaneIntTy>(-1));
+		BENCH_PACK_ONLY("shuffle", x.Shuffle(indices));
+		if constexpr (sizeof(T) >= 4)
+		{
+			BENCH_PACK_ONLY("sort", x.Sort());
+			BENCH_PACK_ONLY("compress", compress(x, x > c).first);
+		}
+	}
+
+	// The simd:: algorithms, at the native width, against their std:: counterparts, which the compiler may vectorize
+	template <typename T>
+	void BenchAlgorithms(Suite& suite)
+	{
+		constexpr size_t bits = NativeBytes * 8;
+		static std::vector<T> in(BufferElems);
+		static std::vector<T> out(BufferElems);
+		for (size_t i = 0; i < BufferElems; i++)
+			in[i] = Opaque(InitialValue<T>(i));
+		const T two = Opaque(static_cast<T>(2));
+		const T threshold = Opaque(InitialValue<T>(3));
+
+		suite.RunPass<T>("simd::transform", bits, BufferElems,
+			[&] { simd::transform<T>(in, out, [&](auto v) { return v * two + two; }); Consume(out[0]); },
+			[&] { std::transform(in.begin(), in.end(), out.begin(), [&](T v) { return static_cast<T>(v * two + two); }); Consume(out[0]); });
+		suite.RunPass<T>("simd::reduce", bits, BufferElems,
+			[&] { Consume(simd::reduce<T>(in, T{}, [](auto a, auto b) { return a + b; })); },
+			[&] { Consume(std::reduce(in.begin(), in.end(), T{})); });
+		suite.RunPass<T>("simd::inclusive_scan", bits, BufferElems,
+			[&] { simd::inclusive_scan<T>(in, out); Consume(out[BufferElems - 1]); },
+			[&] { std::inclusive_scan(in.begin(), in.end(), out.begin()); Consume(out[BufferElems - 1]); });
+		suite.RunPass<T>("simd::exclusive_scan", bits, BufferElems,
+			[&] { simd::exclusive_scan<T>(in, out, T{}); Consume(out[BufferElems - 1]); },
+			[&] { std::exclusive_scan(in.begin(), in.end(), out.begin(), T{}); Consume(out[BufferElems - 1]); });
+		if constexpr (sizeof(T) >= 4)
+		{
+			suite.RunPass<T>("simd::filter", bits, BufferElems,
+				[&] { Consume(simd::filter<T>(in, out, [&](auto v) { return v > threshold; })); },
+				[&] { Consume(std::copy_if(in.begin(), in.end(), out.begin(), [&](T v) { return v > threshold; }) - out.begin()); });
+
+			// Every pass sorts a fresh copy of the same shuffled keys, both sides pay for the copy
+			static std::vector<T> keys(BufferElems);
+			for (size_t i = 0; i < BufferElems; i++)
+				keys[i] = static_cast<T>(i * 2654435761u % 1000003);
+			suite.RunPass<T>("simd::sort", bits, BufferElems,
+				[&] { std::copy(keys.begin(), keys.end(), out.begin()); simd::sort<T>(out); Consume(out[0]); },
+				[&] { std::copy(keys.begin(), keys.end(), out.begin()); std::sort(out.begin(), out.end()); Consume(out[0]); });
+		}
+		if constexpr (std::is_floating_point_v<T>)
+		{
+			static simd::Array<T> a{ std::span<const T>(in) }, b{ std::span<const T>(in) }, result{ BufferElems };
+			suite.RunPass<T>("array_expr", bits, BufferElems,
+				[&] { result = a * b + a; Consume(result[0]); },
+				[&]
+				{
+					for (size_t i = 0; i < BufferElems; i++)
+						out[i] = in[i] * in[i] + in[i];
+					Consume(out[0]);
+				});
+		}
+	}
+
+	// Every pack width up to the native one
+	template <typename T>
+	void BenchType(Suite& suite)
+	{
+		BenchPack<T, 16 / sizeof(T)>(suite);
+		if constexpr (NativeBytes >= 32) BenchPack<T, 32 / sizeof(T)>(suite);
+		if constexpr (NativeBytes >= 64) BenchPack<T, 64 / sizeof(T)>(suite);
+		BenchAlgorithms<T>(suite);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string filter;
+	std::string jsonPath = "benchmark.json";
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string_view arg = argv[i];
+		if (arg == "--filter") filter = argv[i + 1];
+		else if (arg == "--json") jsonPath = argv[i + 1];
+	}
+
+	Suite suite(filter);
+	Suite::PrintHeader();
+	BenchType<float>(suite);
+	BenchType<double>(suite);
+	BenchType<int8_t>(suite);
+	BenchType<uint8_t>(suite);
+	BenchType<int16_t>(suite);
+	BenchType<uint16_t>(suite);
+	BenchType<int32_t>(suite);
+	BenchType<uint32_t>(suite);
+	BenchType<int64_t>(suite);
+	BenchType<uint64_t>(suite);
+	suite.WriteJson(jsonPath);
+	std::cout << "Results written to " << jsonPath << '\n';
+}
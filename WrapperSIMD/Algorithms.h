@@ -0,0 +1,401 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "ValuePack.h"
+
+// Array level algorithms. The callable is applied to whole packs, then once more to a partial pack covering the
+// remaining elements, so no scalar tail loop is needed. The main loop keeps several packs in flight at once
+// to hide instruction latency.
+//
+//	simd::transform(std::span<const float>(in), std::span<float>(out), [](auto x) { return x * x + 1.0f; });
+//	float total = simd::reduce(std::span<const float>(in), 0.0f, [](auto a, auto b) { return a + b; });
+//	size_t kept = simd::filter(std::span<const float>(in), std::span<float>(out), [](auto x) { return x > 0.0f; });
+//	simd::sort(std::span<float>(keys));
+
+inline namespace WRAPPERSIMD_TARGET
+{
+namespace simd
+{
+	// Number of packs processed per loop iteration
+	inline constexpr size_t Unroll = 4;
+	// 'reduce' combines its accumulators pairwise and gives the tail its own accumulator
+	static_assert(std::has_single_bit(Unroll) && Unroll >= 2, "Unroll must be a power of two, at least 2");
+
+	namespace detail
+	{
+		template <typename T>
+		using LaneIdxTy =	std::conditional_t<sizeof(T) == 1, int8_t,
+							std::conditional_t<sizeof(T) == 2, int16_t,
+							std::conditional_t<sizeof(T) == 4, int32_t, int64_t>>>;
+
+		// Mask of the elements before 'n'
+		template <typename T, size_t PackSize>
+		inline BoolPack<PackSize, sizeof(T)> ActiveLanes(size_t n)
+		{
+			using IdxPack = ValuePack<LaneIdxTy<T>, PackSize>;
+			return IdxPack(static_cast<LaneIdxTy<T>>(n)) > IdxPack::template Range<0, 1>();
+		}
+
+		// Elements of 'pack' at or past 'n' are replaced with 'fill'
+		template <typename T, size_t PackSize>
+		inline ValuePack<T, PackSize> FillTail(ValuePack<T, PackSize> pack, size_t n, ValuePack<T, PackSize> fill)
+		{
+			return select(ActiveLanes<T, PackSize>(n), pack, fill);
+		}
+	}
+
+	template <typename T, typename Fn, size_t PackSize = NativeBytes / sizeof(T)>
+	inline void transform(std::span<const T> in, std::span<T> out, Fn fn)
+	{
+		using Pack = ValuePack<T, PackSize>;
+		assert(out.size() >= in.size());
+
+		const T* src = in.data();
+		T* dst = out.data();
+		size_t size = in.size();
+		size_t i = 0;
+
+		for (; i + Unroll * PackSize <= size; i += Unroll * PackSize)
+		{
+			Pack packs[Unroll];
+			for (size_t u = 0; u < Unroll; u++)
+				packs[u] = Pack::LoadUnaligned(src + i + u * PackSize);
+			for (size_t u = 0; u < Unroll; u++)
+				fn(packs[u]).StoreUnaligned(dst + i + u * PackSize);
+		}
+
+		for (; i + PackSize <= size; i += PackSize)
+			fn(Pack::LoadUnaligned(src + i)).StoreUnaligned(dst + i);
+
+		if (i < size)
+			fn(Pack::LoadPartial(src + i, size - i)).StorePartial(dst + i, size - i);
+	}
+
+	// Element-wise 'out[i] = fn(in1[i], in2[i])'
+	template <typename T, typename Fn, size_t PackSize = NativeBytes / sizeof(T)>
+	inline void transform(std::span<const T> in1, std::span<const T> in2, std::span<T> out, Fn fn)
+	{
+		using Pack = ValuePack<T, PackSize>;
+		assert(in2.size() >= in1.size() && out.size() >= in1.size());
+
+		const T* src1 = in1.data();
+		const T* src2 = in2.data();
+		T* dst = out.data();
+		size_t size = in1.size();
+		size_t i = 0;
+
+		for (; i + Unroll * PackSize <= size; i += Unroll * PackSize)
+		{
+			Pack packs[Unroll];
+			for (size_t u = 0; u < Unroll; u++)
+				packs[u] = fn(Pack::LoadUnaligned(src1 + i + u * PackSize), Pack::LoadUnaligned(src2 + i + u * PackSize));
+			for (size_t u = 0; u < Unroll; u++)
+				packs[u].StoreUnaligned(dst + i + u * PackSize);
+		}
+
+		for (; i + PackSize <= size; i += PackSize)
+			fn(Pack::LoadUnaligned(src1 + i), Pack::LoadUnaligned(src2 + i)).StoreUnaligned(dst + i);
+
+		if (i < size)
+			fn(Pack::LoadPartial(src1 + i, size - i), Pack::LoadPartial(src2 + i, size - i)).StorePartial(dst + i, size - i);
+	}
+
+	// Folds every element with 'op', which must be associative and commutative. 'identity' must leave values
+	// unchanged under 'op' (0 for +, 1 for *, the largest value for min, and so on), as it seeds each accumulator
+	// and fills the unused lanes of the tail.
+	// The order of operations differs from a sequential loop, so floating point sums can round differently.
+	template <typename T, typename Op, size_t PackSize = NativeBytes / sizeof(T)>
+	inline T reduce(std::span<const T> in, T identity, Op op)
+	{
+		using Pack = ValuePack<T, PackSize>;
+
+		const T* src = in.data();
+		size_t size = in.size();
+		size_t i = 0;
+
+		// Independent accumulators, so consecutive operations don't wait on each other
+		Pack acc[Unroll];
+		for (size_t u = 0; u < Unroll; u++)
+			acc[u] = Pack(identity);
+
+		for (; i + Unroll * PackSize <= size; i += Unroll * PackSize)
+			for (size_t u = 0; u < Unroll; u++)
+				acc[u] = op(acc[u], Pack::LoadUnaligned(src + i + u * PackSize));
+
+		for (; i + PackSize <= size; i += PackSize)
+			acc[0] = op(acc[0], Pack::LoadUnaligned(src + i));
+
+		if (i < size)
+			acc[1] = op(acc[1], detail::FillTail(Pack::LoadPartial(src + i, size - i), size - i, Pack(identity)));
+
+		// Combine the accumulators pairwise, halving their number each step
+		for (size_t s = Unroll / 2; s > 0; s /= 2)
+			for (size_t u = 0; u < s; u++)
+				acc[u] = op(acc[u], acc[u + s]);
+		Pack total = acc[0];
+
+		alignas(PackSize * sizeof(T)) T lanes[PackSize];
+		total.Store(lanes);
+		// Lanes are folded through broadcast packs, so 'op' only needs to accept packs
+		Pack ret(lanes[0]);
+		for (size_t lane = 1; lane < PackSize; lane++)
+			ret = op(ret, Pack(lanes[lane]));
+		return ret[0];
+	}
+
+	// Copies the elements of 'in' which satisfy 'pred' to the front of 'out', keeping their order, and returns how
+	// many were kept. 'pred' maps a pack to a BoolPack, as the comparison operators do.
+	// Whole packs are stored past the last kept element, so 'out' must be as large as 'in'. It may also be 'in' itself.
+	template <typename T, typename Pred, size_t PackSize = NativeBytes / sizeof(T)>
+	inline size_t filter(std::span<const T> in, std::span<T> out, Pred pred)
+	{
+		using Pack = ValuePack<T, PackSize>;
+		assert(out.size() >= in.size());
+
+		const T* src = in.data();
+		T* dst = out.data();
+		size_t size = in.size();
+		size_t i = 0;
+		size_t kept = 0;
+
+		for (; i + PackSize <= size; i += PackSize)
+		{
+			Pack pack = Pack::LoadUnaligned(src + i);
+			auto [packed, count] = compress(pack, pred(pack));
+			packed.StoreUnaligned(dst + kept);
+			kept += count;
+		}
+
+		if (i < size)
+		{
+			Pack pack = Pack::LoadPartial(src + i, size - i);
+			auto [packed, count] = compress(pack, pred(pack) && detail::ActiveLanes<T, PackSize>(size - i));
+			packed.StorePartial(dst + kept, count);
+			kept += count;
+		}
+
+		return kept;
+	}
+
+	// Running sums, 'out[i] = in[0] + ... + in[i]', as std::inclusive_scan. 'out' may be 'in' itself.
+	// Each pack is scanned in registers, independently of the others, then offset by the total of the packs before
+	// it, so the only dependency between iterations is one addition. Floating point sums may round differently
+	// from a sequential loop.
+	template <typename T, size_t PackSize = NativeBytes / sizeof(T)>
+	inline void inclusive_scan(std::span<const T> in, std::span<T> out)
+	{
+		using Pack = ValuePack<T, PackSize>;
+		assert(out.size() >= in.size());
+
+		const T* src = in.data();
+		T* dst = out.data();
+		size_t size = in.size();
+		size_t i = 0;
+		Pack carry(T(0));
+
+		for (; i + PackSize <= size; i += PackSize)
+		{
+			Pack scanned = Pack::LoadUnaligned(src + i).InclusiveScan();
+			(scanned + carry).StoreUnaligned(dst + i);
+			carry += scanned.template Broadcast<PackSize - 1>();
+		}
+
+		if (i < size)
+			(Pack::LoadPartial(src + i, size - i).InclusiveScan() + carry).StorePartial(dst + i, size - i);
+	}
+
+	// 'out[i] = init + in[0] + ... + in[i - 1]', as std::exclusive_scan. 'out' may be 'in' itself
+	template <typename T, size_t PackSize = NativeBytes / sizeof(T)>
+	inline void exclusive_scan(std::span<const T> in, std::span<T> out, T init)
+	{
+		using Pack = ValuePack<T, PackSize>;
+		assert(out.size() >= in.size());
+
+		const T* src = in.data();
+		T* dst = out.data();
+		size_t size = in.size();
+		size_t i = 0;
+		Pack carry(init);
+
+		for (; i + PackSize <= size; i += PackSize)
+		{
+			Pack pack = Pack::LoadUnaligned(src + i);
+			(pack.ExclusiveScan() + carry).StoreUnaligned(dst + i);
+			carry += pack.InclusiveScan().template Broadcast<PackSize - 1>();
+		}
+
+		if (i < size)
+			(Pack::LoadPartial(src + i, size - i).ExclusiveScan() + carry).StorePartial(dst + i, size - i);
+	}
+
+	namespace detail
+	{
+		// Sorts up to two packs of elements in registers, padding with the largest value
+		template <typename T, size_t PackSize>
+		inline void SortSmall(T* data, size_t n)
+		{
+			using Pack = ValuePack<T, PackSize>;
+			Pack pad = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+
+			size_t lowCount = std::min(n, PackSize);
+			Pack low = FillTail(Pack::LoadPartial(data, lowCount), lowCount, pad).Sort();
+			if (n <= PackSize)
+			{
+				low.StorePartial(data, n);
+				return;
+			}
+
+			size_t highCount = n - PackSize;
+			Pack high = FillTail(Pack::LoadPartial(data + PackSize, highCount), highCount, pad).Sort();
+			auto [lower, upper] = merge(low, high);
+			lower.StoreUnaligned(data);
+			upper.StorePartial(data + PackSize, highCount);
+		}
+
+		// Moves the elements which are less than 'pivot' (or not greater, with 'OrEqual') to the front and returns
+		// how many there are. 'n' must be at least two packs.
+		// Each pack is compressed into the free space at both ends of the range. The first and last packs are held in
+		// registers, which leaves two packs of free space, and reading from the end with less keeps a whole pack free
+		// at each end, so stores can be full width.
+		template <bool OrEqual, typename T, size_t PackSize>
+		inline size_t Partition(T* data, size_t n, T pivot)
+		{
+			using Pack = ValuePack<T, PackSize>;
+			using Mask = BoolPack<PackSize, sizeof(T)>;
+			Pack pivots(pivot);
+
+			auto goesLeft = [&](Pack pack) -> Mask
+			{
+				if constexpr (OrEqual) return !(pack > pivots);
+				else return pack < pivots;
+			};
+
+			size_t readLeft = PackSize;
+			size_t readRight = n - PackSize;
+			size_t writeLeft = 0;
+			size_t writeRight = n;
+
+			auto storeRight = [&](Pack pack, Mask mask)
+			{
+				auto [right, count] = compress(pack, mask);
+				writeRight -= count;
+				right.StorePartial(data + writeRight, count);
+			};
+
+			auto storeLeft = [&](Pack pack, Mask mask)
+			{
+				auto [left, count] = compress(pack, mask);
+				left.StorePartial(data + writeLeft, count);
+				writeLeft += count;
+			};
+
+			Pack first = Pack::LoadUnaligned(data);
+			Pack last = Pack::LoadUnaligned(data + n - PackSize);
+
+			while (readLeft + PackSize <= readRight)
+			{
+				Pack pack;
+				if (readLeft - writeLeft <= writeRight - readRight)
+				{
+					pack = Pack::LoadUnaligned(data + readLeft);
+					readLeft += PackSize;
+				}
+				else
+				{
+					readRight -= PackSize;
+					pack = Pack::LoadUnaligned(data + readRight);
+				}
+
+				Mask mask = goesLeft(pack);
+				auto [left, leftCount] = compress(pack, mask);
+				left.StoreUnaligned(data + writeLeft);
+				writeLeft += leftCount;
+				if constexpr (WRAPPERSIMD_AVX512)
+					storeRight(pack, !mask);
+				else
+				{
+					// The table-driven compress leaves the other elements at the end of the pack, in place for the right
+					left.StoreUnaligned(data + writeRight - PackSize);
+					writeRight -= PackSize - leftCount;
+				}
+			}
+
+			// Fewer than a pack remains between the read positions
+			size_t rest = readRight - readLeft;
+			Pack tail = Pack::LoadPartial(data + readLeft, rest);
+			Mask active = ActiveLanes<T, PackSize>(rest);
+			Mask tailLeft = goesLeft(tail);
+			storeLeft(tail, tailLeft && active);
+			storeRight(tail, (!tailLeft) && active);
+
+			for (Pack pack : { first, last })
+			{
+				Mask mask = goesLeft(pack);
+				storeLeft(pack, mask);
+				storeRight(pack, !mask);
+			}
+
+			return writeLeft;
+		}
+
+		template <typename T, size_t PackSize>
+		inline void QuickSort(T* data, size_t n, int depthBudget)
+		{
+			while (n > 2 * PackSize)
+			{
+				// Bad pivots have made the recursion too deep, fall back to a guaranteed O(n log n) sort
+				if (depthBudget-- == 0)
+				{
+					std::sort(data, data + n);
+					return;
+				}
+
+				T a = data[0], b = data[n / 2], c = data[n - 1];
+				T pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+				size_t split = Partition<false, T, PackSize>(data, n, pivot);
+				if (split == 0)
+				{
+					// The pivot is the smallest element, so its copies can be set aside at the front, already sorted
+					split = Partition<true, T, PackSize>(data, n, pivot);
+					data += split;
+					n -= split;
+					continue;
+				}
+
+				// Recurse into the smaller side and loop on the larger, bounding the stack depth
+				if (split < n - split)
+				{
+					QuickSort<T, PackSize>(data, split, depthBudget);
+					data += split;
+					n -= split;
+				}
+				else
+				{
+					QuickSort<T, PackSize>(data + split, n - split, depthBudget);
+					n = split;
+				}
+			}
+
+			SortSmall<T, PackSize>(data, n);
+		}
+	}
+
+	// Sorts 32 and 64 bit keys in ascending order. Ranges are partitioned around a pivot with 'compress' until
+	// they fit in two packs, which are then sorted in registers. Floating point keys must not be NaN.
+	// Like std::sort, the sort isn't stable and takes O(n log n) time in the worst case.
+	template <typename T, size_t PackSize = NativeBytes / sizeof(T)>
+	inline void sort(std::span<T> data)
+	{
+		static_assert(sizeof(T) == 4 || sizeof(T) == 8, "sort supports 32 and 64 bit keys");
+		detail::QuickSort<T, PackSize>(data.data(), data.size(), 2 * static_cast<int>(std::bit_width(data.size())));
+	}
+}
+} // namespace WRAPPERSIMD_TARGET
@@ -0,0 +1,179 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <span>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "ValuePack.h"
+
+// Aligned storage for data that packs are loaded from.
+//
+//	std::vector<float, AlignedAllocator<float>> values(n);	// Cache line aligned
+//
+//	SimdBuffer<float> buffer(n);	// Padded to whole packs with zeros
+//	for (size_t i = 0; i < buffer.NumPacks(); i++)
+//		buffer.StorePack(i, buffer.LoadPack(i) * 2.0f);
+//
+// Huge page mode aligns and rounds the allocation to 2 MiB and asks for transparent huge pages with madvise, which cuts
+// TLB misses on buffers of many GB. It's only a hint, and does nothing more than align the allocation outside Linux
+// (large pages on Windows need the SeLockMemoryPrivilege).
+
+inline namespace WRAPPERSIMD_TARGET
+{
+namespace detail
+{
+	inline constexpr size_t HugePageSize = size_t{ 2 } << 20;
+
+	inline void* AllocateAligned(size_t bytes, size_t align, bool hugePages)
+	{
+		if (hugePages)
+		{
+			align = std::max(align, HugePageSize);
+			bytes = (bytes + HugePageSize - 1) / HugePageSize * HugePageSize;
+		}
+
+		void* ptr = ::operator new(bytes, std::align_val_t{ align });
+#ifdef __linux__
+		if (hugePages) madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+		return ptr;
+	}
+
+	inline void FreeAligned(void* ptr, size_t align, bool hugePages)
+	{
+		::operator delete(ptr, std::align_val_t{ hugePages ? std::max(align, HugePageSize) : align });
+	}
+}
+
+// Allocator for standard containers, aligning every allocation to 'Align' bytes (a cache line by default)
+template <typename T, size_t Align = 64>
+class AlignedAllocator
+{
+	static_assert(std::has_single_bit(Align) && Align >= alignof(T), "Alignment must be a power of two, at least the alignment of T");
+
+public:
+	using value_type = T;
+
+	template <typename U>
+	struct rebind
+	{
+		using other = AlignedAllocator<U, Align>;
+	};
+
+	AlignedAllocator() noexcept = default;
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Align>&) noexcept {}
+
+	T* allocate(size_t n)
+	{
+		if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+		return static_cast<T*>(detail::AllocateAligned(n * sizeof(T), Align, false));
+	}
+
+	void deallocate(T* ptr, size_t) noexcept
+	{
+		detail::FreeAligned(ptr, Align, false);
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Align>&) const noexcept
+	{
+		return true;
+	}
+};
+
+// Fixed size array whose storage is rounded up to a whole number of packs. Elements past Size() hold the padding value,
+// so loops can process every pack with no tail, as long as the padding doesn't change the result
+// (zero for sums, one for products...). Storing the last pack overwrites the padding, SetPadding restores it.
+template <typename ValTy, size_t PackSize = NativeBytes / sizeof(ValTy)>
+class SimdBuffer
+{
+public:
+	using Pack = ValuePack<ValTy, PackSize>;
+	static constexpr size_t Alignment = std::max(sizeof(Pack), size_t{ 64 });
+
+	SimdBuffer() = default;
+
+	explicit SimdBuffer(size_t size_, ValTy padding_ = ValTy{}, bool hugePages_ = false)
+		: size(size_), padding(padding_), hugePages(hugePages_)
+	{
+		if (size == 0) return;
+		data = static_cast<ValTy*>(detail::AllocateAligned(PaddedSize() * sizeof(ValTy), Alignment, hugePages));
+		std::fill(data, data + size, ValTy{});
+		SetPadding(padding);
+	}
+
+	SimdBuffer(const SimdBuffer& other)
+		: SimdBuffer(other.size, other.padding, other.hugePages)
+	{
+		if (size) std::memcpy(data, other.data, PaddedSize() * sizeof(ValTy));
+	}
+
+	SimdBuffer(SimdBuffer&& other) noexcept
+		: data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)), padding(other.padding), hugePages(other.hugePages) {}
+
+	SimdBuffer& operator=(SimdBuffer other) noexcept
+	{
+		std::swap(data, other.data);
+		std::swap(size, other.size);
+		std::swap(padding, other.padding);
+		std::swap(hugePages, other.hugePages);
+		return *this;
+	}
+
+	~SimdBuffer()
+	{
+		if (data) detail::FreeAligned(data, Alignment, hugePages);
+	}
+
+	size_t Size() const { return size; }
+	size_t PaddedSize() const { return NumPacks() * PackSize; }
+	size_t NumPacks() const { return (size + PackSize - 1) / PackSize; }
+
+	ValTy* Data() { return data; }
+	const ValTy* Data() const { return data; }
+
+	std::span<ValTy> Span() { return { data, size }; }
+	std::span<const ValTy> Span() const { return { data, size }; }
+
+	ValTy& operator[](size_t i) { return data[i]; }
+	const ValTy& operator[](size_t i) const { return data[i]; }
+
+	Pack LoadPack(size_t packIdx) const
+	{
+		assert(packIdx < NumPacks());
+		return Pack::Load(data + packIdx * PackSize);
+	}
+
+	void StorePack(size_t packIdx, Pack pack)
+	{
+		assert(packIdx < NumPacks());
+		pack.Store(data + packIdx * PackSize);
+	}
+
+	// Fills the elements past Size() with 'value'
+	void SetPadding(ValTy value)
+	{
+		padding = value;
+		if (data) std::fill(data + size, data + PaddedSize(), padding);
+	}
+
+	ValTy Padding() const { return padding; }
+
+protected:
+	ValTy* data = nullptr;
+	size_t size = 0;
+	ValTy padding{};
+	bool hugePages = false;
+};
+} // namespace WRAPPERSIMD_TARGET
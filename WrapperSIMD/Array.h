@@ -0,0 +1,319 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "AlignedMemory.h"
+#include "Algorithms.h"
+#include "ValuePack.h"
+
+// Arrays with lazily evaluated element-wise expressions. Operators and math functions on arrays build an expression,
+// which assigning to an array evaluates in one pass, a pack at a time, without temporaries:
+//
+//	simd::Array<float> a(n), b(n), c(n), d(n), e(n), out(n);
+//	out = a * b + c * d - e;
+//	out = simd::sqrt(a * a + b * b) * 0.5f;
+//
+// Every array in an expression must have the same size. Arrays are padded to whole packs (see SimdBuffer), so the loop
+// has no tail. An expression may read the array it is assigned to, since each element only depends on the same element
+// of its operands.
+
+inline namespace WRAPPERSIMD_TARGET
+{
+namespace simd
+{
+	template <typename T>
+	class Array;
+
+	namespace detail
+	{
+		// Base of every expression node, and of Array
+		struct ArrayExprBase {};
+
+		template <typename E>
+		concept ArrayExpr = std::is_base_of_v<ArrayExprBase, std::remove_cvref_t<E>>;
+
+		// Reads an array
+		template <typename T>
+		class ArrayRef : public ArrayExprBase
+		{
+		public:
+			using ValTy = T;
+
+			ArrayRef(const T* data_, size_t size_)
+				: data(data_), size(size_) {}
+
+			size_t Size() const { return size; }
+
+			template <size_t PackSize>
+			ValuePack<T, PackSize> Evaluate(size_t i) const
+			{
+				return ValuePack<T, PackSize>::Load(data + i);
+			}
+
+		protected:
+			const T* data;
+			size_t size;
+		};
+
+		// The same value for every element. Has no size of its own
+		template <typename T>
+		class ScalarExpr : public ArrayExprBase
+		{
+		public:
+			using ValTy = T;
+
+			explicit ScalarExpr(T value_)
+				: value(value_) {}
+
+			size_t Size() const { return 0; }
+
+			template <size_t PackSize>
+			ValuePack<T, PackSize> Evaluate(size_t) const
+			{
+				return ValuePack<T, PackSize>(value);
+			}
+
+		protected:
+			T value;
+		};
+
+		// 'fn' applied to the packs of each operand
+		template <typename Fn, typename... Operands>
+		class MapExpr : public ArrayExprBase
+		{
+		public:
+			using ValTy = typename std::tuple_element_t<0, std::tuple<Operands...>>::ValTy;
+			static_assert((... && std::is_same_v<typename Operands::ValTy, ValTy>), "Array expression operands must have the same element type");
+
+			MapExpr(Fn fn_, Operands... operands_)
+				: fn(fn_), operands(operands_...)
+			{
+				size = std::max({ operands_.Size()... });
+				assert((... && (operands_.Size() == 0 || operands_.Size() == size)));
+			}
+
+			size_t Size() const { return size; }
+
+			template <size_t PackSize>
+			ValuePack<ValTy, PackSize> Evaluate(size_t i) const
+			{
+				return std::apply([&](const Operands&... ops) { return fn(ops.template Evaluate<PackSize>(i)...); }, operands);
+			}
+
+		protected:
+			Fn fn;
+			std::tuple<Operands...> operands;
+			size_t size;
+		};
+
+		// Element type of the first array expression among 'Args'
+		template <typename First, typename... Rest>
+		inline auto ExprValTyOf()
+		{
+			if constexpr (ArrayExpr<First>)
+				return std::type_identity<typename First::ValTy>{};
+			else
+				return ExprValTyOf<Rest...>();
+		}
+
+		// Arrays are held by reference, other nodes by value, and scalars become ScalarExpr
+		template <typename T, typename Arg>
+		inline auto AsNode(const Arg& arg)
+		{
+			if constexpr (std::is_same_v<Arg, Array<T>>)
+				return ArrayRef<T>(arg.Data(), arg.Size());
+			else if constexpr (ArrayExpr<Arg>)
+				return arg;
+			else
+				return ScalarExpr<T>(static_cast<T>(arg));
+		}
+
+		template <typename Fn, typename... Args>
+		inline auto MakeMap(Fn fn, const Args&... args)
+		{
+			using T = typename decltype(ExprValTyOf<Args...>())::type;
+			return MapExpr<Fn, decltype(AsNode<T>(args))...>(fn, AsNode<T>(args)...);
+		}
+
+		// An array expression, or a scalar to combine with one
+		template <typename Arg>
+		concept ExprOperand = ArrayExpr<Arg> || std::is_arithmetic_v<Arg>;
+	}
+
+	template <typename T>
+	class Array : public detail::ArrayExprBase
+	{
+	public:
+		using ValTy = T;
+		using Pack = NativePack<T>;
+		static constexpr size_t PackSize = Pack::Size();
+
+		Array() = default;
+
+		explicit Array(size_t size, T value = T{})
+			: buffer(size)
+		{
+			std::fill(buffer.Data(), buffer.Data() + size, value);
+		}
+
+		explicit Array(std::span<const T> values)
+			: buffer(values.size())
+		{
+			std::copy(values.begin(), values.end(), buffer.Data());
+		}
+
+		template <detail::ArrayExpr E>
+		Array(const E& expr)
+			: buffer(expr.Size())
+		{
+			Assign(expr);
+		}
+
+		// Evaluates 'expr' into this array, which is sized to fit if it's empty
+		template <detail::ArrayExpr E>
+		Array& operator=(const E& expr)
+		{
+			if (Size() == 0) buffer = SimdBuffer<T>(expr.Size());
+			Assign(expr);
+			return *this;
+		}
+
+		Array& operator=(T value)
+		{
+			std::fill(buffer.Data(), buffer.Data() + Size(), value);
+			return *this;
+		}
+
+		template <detail::ExprOperand E> Array& operator+=(const E& other) { return *this = *this + other; }
+		template <detail::ExprOperand E> Array& operator-=(const E& other) { return *this = *this - other; }
+		template <detail::ExprOperand E> Array& operator*=(const E& other) { return *this = *this * other; }
+		template <detail::ExprOperand E> Array& operator/=(const E& other) { return *this = *this / other; }
+
+		size_t Size() const { return buffer.Size(); }
+
+		T* Data() { return buffer.Data(); }
+		const T* Data() const { return buffer.Data(); }
+
+		std::span<T> Span() { return buffer.Span(); }
+		std::span<const T> Span() const { return buffer.Span(); }
+
+		T& operator[](size_t i) { return buffer[i]; }
+		const T& operator[](size_t i) const { return buffer[i]; }
+
+		template <size_t OtherPackSize>
+		ValuePack<T, OtherPackSize> Evaluate(size_t i) const
+		{
+			return ValuePack<T, OtherPackSize>::Load(Data() + i);
+		}
+
+	protected:
+		template <typename E>
+		void Assign(const E& expr)
+		{
+			assert(expr.Size() == Size() || expr.Size() == 0);
+			auto node = detail::AsNode<T>(expr);
+
+			size_t numPacks = buffer.NumPacks();
+			size_t i = 0;
+			for (; i + Unroll <= numPacks; i += Unroll)
+			{
+				Pack packs[Unroll];
+				for (size_t u = 0; u < Unroll; u++)
+					packs[u] = node.template Evaluate<PackSize>((i + u) * PackSize);
+				for (size_t u = 0; u < Unroll; u++)
+					buffer.StorePack(i + u, packs[u]);
+			}
+
+			for (; i < numPacks; i++)
+				buffer.StorePack(i, node.template Evaluate<PackSize>(i * PackSize));
+		}
+
+		SimdBuffer<T> buffer;
+	};
+
+#define ARRAY_BINARY_OPERATOR(op)\
+template <detail::ExprOperand A, detail::ExprOperand B> requires (detail::ArrayExpr<A> || detail::ArrayExpr<B>)\
+inline auto operator op (const A& a, const B& b)\
+{\
+	return detail::MakeMap([](auto x, auto y) { return x op y; }, a, b);\
+}
+
+#define ARRAY_UNARY_FUNC(funcName)\
+template <detail::ArrayExpr A>\
+inline auto funcName (const A& a)\
+{\
+	return detail::MakeMap([](auto x) { return funcName(x); }, a);\
+}
+
+#define ARRAY_BINARY_FUNC(funcName)\
+template <detail::ExprOperand A, detail::ExprOperand B> requires (detail::ArrayExpr<A> || detail::ArrayExpr<B>)\
+inline auto funcName (const A& a, const B& b)\
+{\
+	return detail::MakeMap([](auto x, auto y) { return funcName(x, y); }, a, b);\
+}
+
+#define ARRAY_TERNARY_FUNC(funcName)\
+template <detail::ExprOperand A, detail::ExprOperand B, detail::ExprOperand C> requires (detail::ArrayExpr<A> || detail::ArrayExpr<B> || detail::ArrayExpr<C>)\
+inline auto funcName (const A& a, const B& b, const C& c)\
+{\
+	return detail::MakeMap([](auto x, auto y, auto z) { return funcName(x, y, z); }, a, b, c);\
+}
+
+	ARRAY_BINARY_OPERATOR(+);
+	ARRAY_BINARY_OPERATOR(-);
+	ARRAY_BINARY_OPERATOR(*);
+	ARRAY_BINARY_OPERATOR(/);
+
+	template <detail::ArrayExpr A>
+	inline auto operator-(const A& a)
+	{
+		return detail::MakeMap([](auto x) { return -x; }, a);
+	}
+
+	// Trigonometric
+	ARRAY_UNARY_FUNC(sin);
+	ARRAY_UNARY_FUNC(cos);
+	ARRAY_UNARY_FUNC(tan);
+	ARRAY_UNARY_FUNC(asin);
+	ARRAY_UNARY_FUNC(acos);
+	ARRAY_UNARY_FUNC(atan);
+	ARRAY_BINARY_FUNC(atan2);
+	ARRAY_UNARY_FUNC(sinh);
+	ARRAY_UNARY_FUNC(cosh);
+	ARRAY_UNARY_FUNC(tanh);
+	ARRAY_UNARY_FUNC(asinh);
+	ARRAY_UNARY_FUNC(acosh);
+	ARRAY_UNARY_FUNC(atanh);
+
+	// Exponential, logarithmic and powers
+	ARRAY_UNARY_FUNC(exp);
+	ARRAY_UNARY_FUNC(log);
+	ARRAY_UNARY_FUNC(log2);
+	ARRAY_UNARY_FUNC(log10);
+	ARRAY_UNARY_FUNC(sqrt);
+	ARRAY_UNARY_FUNC(cbrt);
+	ARRAY_UNARY_FUNC(invsqrt);
+	ARRAY_UNARY_FUNC(invcbrt);
+	ARRAY_BINARY_FUNC(pow);
+
+	// Rounding
+	ARRAY_UNARY_FUNC(floor);
+	ARRAY_UNARY_FUNC(round);
+	ARRAY_UNARY_FUNC(ceil);
+	ARRAY_UNARY_FUNC(trunc);
+
+	// Arithmetic
+	ARRAY_UNARY_FUNC(abs);
+	ARRAY_BINARY_FUNC(min);
+	ARRAY_BINARY_FUNC(max);
+	ARRAY_TERNARY_FUNC(fma);
+	ARRAY_TERNARY_FUNC(fms);
+	ARRAY_TERNARY_FUNC(fnma);
+	ARRAY_TERNARY_FUNC(fnms);
+}
+} // namespace WRAPPERSIMD_TARGET
@@ -0,0 +1,168 @@
+#pragma once
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#include "ValuePack.h"
+
+// Runtime selection between builds of the same kernel for different instruction sets.
+//
+// A kernel is written once against NativePack, inside the target namespace so that each build gets its own symbol:
+//
+//	// Saxpy.h, included by every translation unit below
+//	DISPATCH_DECLARE(Saxpy, void(float, const float*, float*, size_t));
+//
+//	// Saxpy.inl, compiled three times: without /arch, with /arch:AVX2 and with /arch:AVX512
+//	// (-msse4.2, -mavx2 -mfma and -mavx512f -mavx512dq -mavx512bw -mavx512vl on GCC and Clang)
+//	namespace WRAPPERSIMD_TARGET
+//	{
+//		void SaxpyKernel(float a, const float* x, float* y, size_t n) { ... NativePack<float> ... }
+//	}
+//	DISPATCH_EXPORT(Saxpy, SaxpyKernel);
+//
+//	// Exactly one translation unit built for the baseline target
+//	DISPATCH_DEFINE(Saxpy);
+//
+// 'Saxpy' is then a function pointer, resolved once during static initialization, and called directly.
+// A target which isn't built is declared with DISPATCH_SKIP(Saxpy, simd_avx512) instead of its DISPATCH_EXPORT.
+//
+// The AVX-512 build must not add -mavx512vbmi, which DetectInstructionSet() doesn't require. Without it, 512 bit
+// byte permutes are built from AVX512BW's 'pshufb' instead of 'vpermb'.
+
+enum class InstructionSet
+{
+	SSE42,
+	AVX2,
+	AVX512
+};
+
+struct CpuFeatures
+{
+	bool sse42 = false;
+	bool avx = false;
+	bool avx2 = false;
+	bool fma = false;
+	bool avx512f = false;
+	bool avx512dq = false;
+	bool avx512bw = false;
+	bool avx512vl = false;
+	bool avx512vbmi = false;
+};
+
+namespace dispatch_detail
+{
+	inline void Cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+	{
+#ifdef _MSC_VER
+		int out[4];
+		__cpuidex(out, (int)leaf, (int)subleaf);
+		for (size_t i = 0; i < 4; i++)
+			regs[i] = (uint32_t)out[i];
+#else
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	// Which register states the OS saves on context switches
+	inline uint64_t Xgetbv()
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		uint32_t eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return ((uint64_t)edx << 32) | eax;
+#endif
+	}
+
+	inline bool Bit(uint32_t reg, int bit)
+	{
+		return (reg >> bit) & 1;
+	}
+
+	inline CpuFeatures QueryCpuFeatures()
+	{
+		CpuFeatures ret;
+		uint32_t regs[4];
+
+		Cpuid(0, 0, regs);
+		uint32_t maxLeaf = regs[0];
+		if (maxLeaf < 1) return ret;
+
+		Cpuid(1, 0, regs);
+		ret.sse42 = Bit(regs[2], 20);
+		bool osxsave = Bit(regs[2], 27);
+		bool cpuAvx = Bit(regs[2], 28);
+		bool cpuFma = Bit(regs[2], 12);
+
+		// The CPU supporting AVX isn't enough, the OS must also preserve the YMM / ZMM registers
+		uint64_t xcr0 = osxsave ? Xgetbv() : 0;
+		bool osAvx = (xcr0 & 0x6) == 0x6;
+		bool osAvx512 = (xcr0 & 0xE6) == 0xE6;
+
+		ret.avx = cpuAvx && osAvx;
+		ret.fma = cpuFma && osAvx;
+		if (maxLeaf < 7) return ret;
+
+		Cpuid(7, 0, regs);
+		ret.avx2 = ret.avx && Bit(regs[1], 5);
+		ret.avx512f = osAvx512 && Bit(regs[1], 16);
+		ret.avx512dq = ret.avx512f && Bit(regs[1], 17);
+		ret.avx512bw = ret.avx512f && Bit(regs[1], 30);
+		ret.avx512vl = ret.avx512f && Bit(regs[1], 31);
+		ret.avx512vbmi = ret.avx512f && Bit(regs[2], 1);
+		return ret;
+	}
+}
+
+// Only call these from baseline code, they are compiled with whatever flags the including translation unit has
+inline const CpuFeatures& GetCpuFeatures()
+{
+	static const CpuFeatures features = dispatch_detail::QueryCpuFeatures();
+	return features;
+}
+
+inline InstructionSet DetectInstructionSet()
+{
+	const CpuFeatures& cpu = GetCpuFeatures();
+
+	// Matches what /arch:AVX512 and /arch:AVX2 allow the compiler to emit
+	if (cpu.avx512f && cpu.avx512dq && cpu.avx512bw && cpu.avx512vl && cpu.fma)
+		return InstructionSet::AVX512;
+	if (cpu.avx2 && cpu.fma)
+		return InstructionSet::AVX2;
+	return InstructionSet::SSE42;
+}
+
+// Picks the best available build, falling back to narrower ones which were built
+template <typename Fn>
+inline Fn* SelectTarget(Fn* sse42, Fn* avx2, Fn* avx512)
+{
+	InstructionSet isa = DetectInstructionSet();
+	if (isa == InstructionSet::AVX512 && avx512) return avx512;
+	if (isa >= InstructionSet::AVX2 && avx2) return avx2;
+	return sse42;
+}
+
+#define DISPATCH_DECLARE(name, ...)\
+namespace name##_Dispatch\
+{\
+	using Sig = __VA_ARGS__;\
+	extern Sig* const simd_sse42;\
+	extern Sig* const simd_avx2;\
+	extern Sig* const simd_avx512;\
+}\
+extern name##_Dispatch::Sig* const name
+
+#define DISPATCH_EXPORT(name, impl)\
+extern name##_Dispatch::Sig* const name##_Dispatch::WRAPPERSIMD_TARGET = &::WRAPPERSIMD_TARGET::impl
+
+#define DISPATCH_SKIP(name, target)\
+extern name##_Dispatch::Sig* const name##_Dispatch::target = nullptr
+
+#define DISPATCH_DEFINE(name)\
+extern name##_Dispatch::Sig* const name = SelectTarget(name##_Dispatch::simd_sse42, name##_Dispatch::simd_avx2, name##_Dispatch::simd_avx512)
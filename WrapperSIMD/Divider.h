@@ -0,0 +1,204 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "ValuePack.h"
+
+// Integer division of packs by a divisor which is only known at runtime, but reused many times.
+// The division is replaced with a multiply-high by a precomputed magic number and a few shifts
+// (Granlund & Montgomery, "Division by Invariant Integers using Multiplication", 1994).
+//
+//	Divider<uint32_t> buckets(numBuckets);
+//	ValuePack<uint32_t, 8> bucket = hashes % buckets;
+//
+// Results match the scalar operators, rounding towards zero. Dividing the minimum signed value by -1 wraps.
+
+inline namespace WRAPPERSIMD_TARGET
+{
+namespace detail
+{
+	// (hi * 2^64 + lo) / d, the quotient must fit 64 bits (hi < d)
+	inline uint64_t DivideWide(uint64_t hi, uint64_t lo, uint64_t d)
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		uint64_t remainder;
+		return _udiv128(hi, lo, d, &remainder);
+#else
+		return static_cast<uint64_t>(((static_cast<unsigned __int128>(hi) << 64) | lo) / d);
+#endif
+	}
+
+	// floor(hi * 2^Bits / d) for a divisor of the given width, hi < d
+	template <size_t Bits>
+	inline uint64_t ShiftedQuotient(uint64_t hi, uint64_t d)
+	{
+		if constexpr (Bits == 64)
+			return DivideWide(hi, 0, d);
+		else
+			return (hi << Bits) / d;
+	}
+
+	// 64 bit products of the low 32 bits of each 64 bit slot, signed or unsigned as ValTy
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> MulEven32(ValuePack<ValTy, PackSize> a, ValuePack<ValTy, PackSize> b)
+	{
+		using HalfTy = std::conditional_t<std::is_signed_v<ValTy>, int32_t, uint32_t>;
+		RETURN_OP(sizeof(ValTy) * PackSize * 8, mul, HalfTy, a.pack, b.pack);
+	}
+
+	// Logical right shift of each 64 bit slot
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> ShiftRight64(ValuePack<ValTy, PackSize> a, int x)
+	{
+		RETURN_OP(sizeof(ValTy) * PackSize * 8, srli, int64_t, a.pack, x);
+	}
+
+	// High half of each product
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> MulHi(ValuePack<ValTy, PackSize> a, ValuePack<ValTy, PackSize> b)
+	{
+		if constexpr (sizeof(ValTy) == 1)
+		{
+			// No byte multiply, multiply the even and odd bytes separately as 16 bit elements
+			using WideTy = std::conditional_t<std::is_signed_v<ValTy>, int16_t, uint16_t>;
+			using Wide = ValuePack<WideTy, PackSize / 2>;
+			Wide a16 = a.pack;
+			Wide b16 = b.pack;
+			Wide even = (((a16 << 8) >> 8) * ((b16 << 8) >> 8)) >> 8;
+			Wide odd = (a16 >> 8) * (b16 >> 8);
+			return ((even & static_cast<WideTy>(0x00FF)) | (odd & static_cast<WideTy>(0xFF00))).pack;
+		}
+		else if constexpr (sizeof(ValTy) == 2)
+		{
+			RETURN_OP(sizeof(ValTy) * PackSize * 8, mulhi, ValTy, a.pack, b.pack);
+		}
+		else if constexpr (sizeof(ValTy) == 4)
+		{
+			// pmuludq / pmuldq only multiply the even elements, the odd elements are shifted down to be multiplied
+			ValuePack<ValTy, PackSize> even = ShiftRight64(MulEven32(a, b), 32);
+			ValuePack<ValTy, PackSize> odd = MulEven32(ShiftRight64(a, 32), ShiftRight64(b, 32));
+			return [&]<size_t... Lanes>(std::index_sequence<Lanes...>)
+			{
+				return even.template Blend<(Lanes % 2 == 1)...>(odd);
+			}(std::make_index_sequence<PackSize>());
+		}
+		else
+		{
+			// Schoolbook multiplication on 32 bit halves
+			using U64 = ValuePack<uint64_t, PackSize>;
+			U64 ua = a.pack;
+			U64 ub = b.pack;
+			U64 low32 = static_cast<uint64_t>(0xFFFF'FFFF);
+			U64 aHi = ua >> 32;
+			U64 bHi = ub >> 32;
+			U64 ll = MulEven32(ua, ub);
+			U64 lh = MulEven32(ua, bHi);
+			U64 hl = MulEven32(aHi, ub);
+			U64 hh = MulEven32(aHi, bHi);
+			U64 mid = (ll >> 32) + (lh & low32) + (hl & low32);
+			U64 hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+
+			if constexpr (std::is_signed_v<ValTy>)
+			{
+				// Interpreting a negative operand as unsigned adds 2^64 times the other operand to the product
+				ValuePack<ValTy, PackSize> zero = static_cast<ValTy>(0);
+				U64 aNeg = select(a < zero, b, zero).pack;
+				U64 bNeg = select(b < zero, a, zero).pack;
+				hi = hi - aNeg - bNeg;
+			}
+			return hi.pack;
+		}
+	}
+}
+
+template <typename ValTy>
+class Divider
+{
+	static_assert(std::is_integral_v<ValTy> && sizeof(ValTy) <= 8, "Divider requires an integer type");
+
+	using UValTy = std::make_unsigned_t<ValTy>;
+	static constexpr int Bits = sizeof(ValTy) * 8;
+
+public:
+	explicit Divider(ValTy divisor_)
+		: divisor(divisor_)
+	{
+		assert(divisor != 0);
+
+		if constexpr (std::is_unsigned_v<ValTy>)
+		{
+			// m = floor(2^N * (2^l - d) / d) + 1, l = ceil(log2(d))
+			int l = std::bit_width(static_cast<UValTy>(divisor - 1));
+			UValTy twoL = (l == Bits) ? UValTy{ 0 } : static_cast<UValTy>(UValTy{ 1 } << l);
+			UValTy numerator = static_cast<UValTy>(twoL - divisor);
+			magic = static_cast<ValTy>(detail::ShiftedQuotient<Bits>(numerator, divisor) + 1);
+			shift1 = std::min(l, 1);
+			shift2 = std::max(l - 1, 0);
+		}
+		else
+		{
+			// m = 2^(N + l - 1) / |d| + 1 - 2^N, l = max(ceil(log2(|d|)), 1)
+			UValTy absDivisor = divisor < 0 ? static_cast<UValTy>(UValTy{ 0 } - static_cast<UValTy>(divisor)) : static_cast<UValTy>(divisor);
+			int l = std::max(static_cast<int>(std::bit_width(static_cast<UValTy>(absDivisor - 1))), 1);
+			if (absDivisor == 1)
+				magic = 1;
+			else
+				magic = static_cast<ValTy>(static_cast<UValTy>(detail::ShiftedQuotient<Bits>(uint64_t{ 1 } << (l - 1), absDivisor) + 1));
+			shift1 = l - 1;
+			divisorSign = divisor < 0 ? ValTy(-1) : ValTy(0);
+		}
+	}
+
+	ValTy Divisor() const
+	{
+		return divisor;
+	}
+
+	template <size_t PackSize>
+	ValuePack<ValTy, PackSize> Divide(ValuePack<ValTy, PackSize> n) const
+	{
+		using Pack = ValuePack<ValTy, PackSize>;
+		Pack q = detail::MulHi(n, Pack(magic));
+
+		if constexpr (std::is_unsigned_v<ValTy>)
+		{
+			Pack t = ((n - q) >> shift1) + q;
+			return t >> shift2;
+		}
+		else
+		{
+			// Round towards zero by adding one to negative quotients, then apply the divisor's sign
+			q = ((n + q) >> shift1) - (n >> (Bits - 1));
+			Pack sign = divisorSign;
+			return (q ^ sign) - sign;
+		}
+	}
+
+protected:
+	ValTy divisor;
+	ValTy magic;
+	int shift1 = 0;
+	int shift2 = 0;
+	ValTy divisorSign = 0;
+};
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> operator/(ValuePack<ValTy, PackSize> pack, const Divider<ValTy>& divider)
+{
+	return divider.Divide(pack);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> operator%(ValuePack<ValTy, PackSize> pack, const Divider<ValTy>& divider)
+{
+	return pack - divider.Divide(pack) * divider.Divisor();
+}
+} // namespace WRAPPERSIMD_TARGET
@@ -0,0 +1,784 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <type_traits>
+
+#include "ValuePack.h"
+
+// In-house replacements for the SVML transcendental functions, used on compilers which don't ship SVML.
+// Every function accepts float and double packs of any supported width. Each one reduces its argument to a small
+// interval and evaluates a minimax polynomial (or rational) approximation there.
+//
+// Maximum error, measured against the long double libm on random arguments over the stated domain:
+//
+//	Function		float		double		Domain
+//	sin, cos		2.5 ulp		1.5 ulp		all, lanes above 8192 (float) or 2^30 (double) take a slower scalar reduction
+//	tan				3.5 ulp		3.5 ulp		as sin
+//	asin, acos		4 ulp		2.5 ulp		[-1, 1]
+//	atan			3 ulp		1 ulp		all
+//	atan2			3.5 ulp		2 ulp		all
+//	sinh, cosh		2.5 ulp		2.5 ulp		all
+//	tanh			2.5 ulp		3 ulp		all
+//	asinh, acosh	3.5 ulp		3.5 ulp		all
+//	atanh			3 ulp		3.5 ulp		[-1, 1]
+//	exp				1 ulp		1 ulp		all
+//	log				1 ulp		1 ulp		all
+//	log2, log10		2.5 ulp		2 ulp		all
+//	pow				1.5 ulp		1.5 ulp		all
+//	cbrt			1 ulp		1 ulp		all
+//	invcbrt			2 ulp		2 ulp		all
+//	invsqrt			1.5 ulp		1.5 ulp		all
+//	erf				2.5 ulp		3 ulp		all
+//
+// Special values (NaN, infinities, zeroes and out-of-domain arguments) follow the C standard library.
+
+inline namespace WRAPPERSIMD_TARGET
+{
+namespace detail
+{
+	template <typename ValTy>
+	using MathIntTy = std::conditional_t<std::is_same_v<ValTy, float>, int32_t, int64_t>;
+
+	template <typename ValTy>
+	constexpr int MantissaBits = std::numeric_limits<ValTy>::digits - 1;
+
+	template <typename ValTy>
+	constexpr int ExponentBias = std::numeric_limits<ValTy>::max_exponent - 1;
+
+	// Adding this to an integer valued float leaves the integer in the low mantissa bits
+	template <typename ValTy>
+	constexpr ValTy IntShifter = static_cast<ValTy>(1.5 * (uint64_t{ 1 } << MantissaBits<ValTy>));
+
+	// Evaluates a polynomial with the given coefficients, highest order first
+	template <typename ValTy, size_t PackSize, typename... Coeffs>
+	inline ValuePack<ValTy, PackSize> Horner(ValuePack<ValTy, PackSize> x, double first, Coeffs... others)
+	{
+		using Pack = ValuePack<ValTy, PackSize>;
+		Pack ret = static_cast<ValTy>(first);
+		((ret = fma(ret, x, Pack(static_cast<ValTy>(others)))), ...);
+		return ret;
+	}
+
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> SignBit(ValuePack<ValTy, PackSize> x)
+	{
+		return x & static_cast<ValTy>(-0.0);
+	}
+
+	// Bit 'bit' of each lane of an integer valued pack, moved into the sign bit
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> BitToSign(ValuePack<ValTy, PackSize> n, int bit)
+	{
+		using IntTy = MathIntTy<ValTy>;
+		ValuePack<IntTy, PackSize> bits = (n + IntShifter<ValTy>).template Cast<IntTy>();
+		return ((bits & (IntTy{ 1 } << bit)) << (static_cast<int>(sizeof(IntTy)) * 8 - 1 - bit)).template Cast<ValTy>();
+	}
+
+	// Whether bit 'bit' is set in each lane of an integer valued pack
+	template <typename ValTy, size_t PackSize>
+	inline BoolPack<PackSize, sizeof(ValTy)> BitSet(ValuePack<ValTy, PackSize> n, int bit)
+	{
+		using IntTy = MathIntTy<ValTy>;
+		IntTy mask = IntTy{ 1 } << bit;
+		return ((n + IntShifter<ValTy>).template Cast<IntTy>() & mask) == mask;
+	}
+
+	// 2^n for integer valued n within the normal exponent range
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> Pow2(ValuePack<ValTy, PackSize> n)
+	{
+		using IntTy = MathIntTy<ValTy>;
+		ValuePack<IntTy, PackSize> bits = (n + (IntShifter<ValTy> + ExponentBias<ValTy>)).template Cast<IntTy>();
+		return (bits << MantissaBits<ValTy>).template Cast<ValTy>();
+	}
+
+	// x * 2^n, split into two steps so that the result may overflow or become subnormal
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> ScaleByPow2(ValuePack<ValTy, PackSize> x, ValuePack<ValTy, PackSize> n)
+	{
+		ValuePack<ValTy, PackSize> half = floor(n * static_cast<ValTy>(0.5));
+		return x * Pow2(half) * Pow2(n - half);
+	}
+
+	// Reduces x to r = x - n * ln(2), |r| <= ln(2) / 2, returning n
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> ReduceLn2(ValuePack<ValTy, PackSize> x, ValuePack<ValTy, PackSize>& r)
+	{
+		// ln(2) is split into a part with few significant bits, so that n * Ln2Hi is exact, and the remainder
+		static constexpr ValTy Ln2Hi = static_cast<ValTy>(0.693145751953125);
+		static constexpr ValTy Ln2Lo = static_cast<ValTy>(1.42860682030941723212e-6);
+
+		// Limit the argument so that every result fits the two step scaling, results still saturate to 0 or inf
+		static constexpr ValTy Limit = std::is_same_v<ValTy, float> ? static_cast<ValTy>(170.0) : static_cast<ValTy>(1400.0);
+		x = min(ValuePack<ValTy, PackSize>(Limit), max(ValuePack<ValTy, PackSize>(-Limit), x));
+
+		ValuePack<ValTy, PackSize> n = rint(x * std::numbers::log2e_v<ValTy>);
+		r = fnma(n, ValuePack<ValTy, PackSize>(Ln2Lo), fnma(n, ValuePack<ValTy, PackSize>(Ln2Hi), x));
+		return n;
+	}
+
+	// (e^r - 1 - r) / r^2 for |r| <= ln(2) / 2
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> ExpPoly(ValuePack<ValTy, PackSize> r)
+	{
+		if constexpr (std::is_same_v<ValTy, float>)
+			return Horner(r, 1.9875691500e-4, 1.3981999507e-3, 8.3334519073e-3, 4.1665795894e-2, 1.6666665459e-1, 5.0000001201e-1);
+		else
+			return Horner(r, 2.08860621107283687536341e-09, 2.51112930892876518610661e-08, 2.75573911234900471893338e-07,
+				2.75572362911928827629423e-06, 2.4801587159235472998791e-05, 0.000198412698960509205564975,
+				0.00138888888889774492207962, 0.00833333333331652721664984, 0.0416666666666665047591422,
+				0.166666666666666851703837, 0.5);
+	}
+
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> Exp(ValuePack<ValTy, PackSize> x)
+	{
+		ValuePack<ValTy, PackSize> r;
+		ValuePack<ValTy, PackSize> n = ReduceLn2(x, r);
+		return ScaleByPow2(fma(r * r, ExpPoly(r), r) + static_cast<ValTy>(1.0), n);
+	}
+
+	// e^(x + xLo), for a finite correction xLo far below the ulp of x
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> Exp(ValuePack<ValTy, PackSize> x, ValuePack<ValTy, PackSize> xLo)
+	{
+		ValuePack<ValTy, PackSize> r;
+		ValuePack<ValTy, PackSize> n = ReduceLn2(x, r);
+		r = r + xLo;
+		return ScaleByPow2(fma(r * r, ExpPoly(r), r) + static_cast<ValTy>(1.0), n);
+	}
+
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> ExpM1(ValuePack<ValTy, PackSize> x)
+	{
+		ValuePack<ValTy, PackSize> r;
+		ValuePack<ValTy, PackSize> n = ReduceLn2(x, r);
+		ValuePack<ValTy, PackSize> half = floor(n * static_cast<ValTy>(0.5));
+		ValuePack<ValTy, PackSize> scale = Pow2(half) * Pow2(n - half);
+
+		// e^x - 1 = 2^n * (e^r - 1) + (2^n - 1), exact for n = 0
+		return fma(scale, fma(r * r, ExpPoly(r), r), scale - static_cast<ValTy>(1.0));
+	}
+
+	// e^x / 2, without overflowing early for x close to the overflow threshold
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> HalfExp(ValuePack<ValTy, PackSize> x)
+	{
+		// x - Ln2Hi is exact, the remaining e^-Ln2Lo is applied as a constant factor
+		return Exp(x - static_cast<ValTy>(0.693145751953125)) * static_cast<ValTy>(0.9999985713942001);
+	}
+
+	// Above this |x|, sinh and cosh use e^|x| / 2 alone, and tanh saturates to 1
+	template <typename ValTy>
+	constexpr ValTy HyperbolicCutoff = std::is_same_v<ValTy, float> ? static_cast<ValTy>(9.0) : static_cast<ValTy>(20.0);
+
+	// Above this |x|, asinh and acosh use log(2x), avoiding overflow of x^2
+	template <typename ValTy>
+	constexpr ValTy InvHyperbolicCutoff = std::is_same_v<ValTy, float> ? static_cast<ValTy>(1e4) : static_cast<ValTy>(1e9);
+
+	// Splits a positive x into m * 2^e with m in [sqrt(1/2), sqrt(2)), returning m
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> SplitLogArg(ValuePack<ValTy, PackSize> x, ValuePack<ValTy, PackSize>& e)
+	{
+		using Pack = ValuePack<ValTy, PackSize>;
+		using IntTy = MathIntTy<ValTy>;
+		using UIntTy = std::make_unsigned_t<IntTy>;
+		using IntPack = ValuePack<IntTy, PackSize>;
+
+		static constexpr int Mant = MantissaBits<ValTy>;
+		static constexpr IntTy OneBits = std::bit_cast<IntTy>(static_cast<ValTy>(1.0));
+		static constexpr IntTy SqrtHalfBits = std::bit_cast<IntTy>(std::numbers::sqrt2_v<ValTy> * static_cast<ValTy>(0.5));
+		static constexpr IntTy MantMask = (IntTy{ 1 } << Mant) - 1;
+
+		// Scale subnormals into the normal range
+		BoolPack<PackSize, sizeof(ValTy)> subnormal = x < std::numeric_limits<ValTy>::min();
+		Pack scaled = select(subnormal, x * static_cast<ValTy>(uint64_t{ 1 } << Mant), x);
+		Pack expAdjust = select(subnormal, Pack(static_cast<ValTy>(-Mant)), Pack(static_cast<ValTy>(0.0)));
+
+		IntPack bits = scaled.template Cast<IntTy>() + (OneBits - SqrtHalfBits);
+		IntPack expField = (bits.template Cast<UIntTy>() >> Mant).template Cast<IntTy>();
+		e = (expField | std::bit_cast<IntTy>(static_cast<ValTy>(uint64_t{ 1 } << Mant))).template Cast<ValTy>()
+			- static_cast<ValTy>((uint64_t{ 1 } << Mant) + ExponentBias<ValTy>) + expAdjust;
+		return ((bits & MantMask) + SqrtHalfBits).template Cast<ValTy>();
+	}
+
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> Log(ValuePack<ValTy, PackSize> x)
+	{
+		using Pack = ValuePack<ValTy, PackSize>;
+		static constexpr ValTy Inf = std::numeric_limits<ValTy>::infinity();
+
+		Pack e;
+		Pack m = SplitLogArg(x, e);
+
+		// log(m) = 2 * atanh(s), s = (m - 1) / (m + 1)
+		Pack f = m - static_cast<ValTy>(1.0);
+		Pack s = f / (f + static_cast<ValTy>(2.0));
+		Pack z = s * s;
+		Pack poly;
+		if constexpr (std::is_same_v<ValTy, float>)
+			poly = Horner(z, 2.4279078841e-01, 2.8498786688e-01, 4.0000972152e-01, 6.6666662693e-01);
+		else
+			poly = Horner(z, 1.479819860511658591e-01, 1.531383769920937332e-01, 1.818357216161805012e-01, 2.222219843214978396e-01,
+				2.857142874366239149e-01, 3.999999999940941908e-01, 6.666666666666735130e-01);
+		Pack R = z * poly;
+		Pack hfsq = f * f * static_cast<ValTy>(0.5);
+
+		// ln(2) split as in ReduceLn2, so that e * Ln2Hi is exact
+		static constexpr ValTy Ln2Hi = std::is_same_v<ValTy, float> ? static_cast<ValTy>(6.9313812256e-01) : static_cast<ValTy>(6.93147180369123816490e-01);
+		static constexpr ValTy Ln2Lo = std::is_same_v<ValTy, float> ? static_cast<ValTy>(9.0580006145e-06) : static_cast<ValTy>(1.90821492927058770002e-10);
+		Pack ret = e * Ln2Hi - ((hfsq - (s * (hfsq + R) + e * Ln2Lo)) - f);
+
+		// Zero, negative, infinite and NaN arguments
+		BoolPack<PackSize, sizeof(ValTy)> special = !((x > static_cast<ValTy>(0.0)) && (x < Inf));
+		Pack specialRet = select(x == static_cast<ValTy>(0.0), Pack(-Inf),
+			select(x < static_cast<ValTy>(0.0), Pack(std::numeric_limits<ValTy>::quiet_NaN()), x));
+		return select(special, specialRet, ret);
+	}
+
+	// The rounding error a * b - p of the product p = a * b, exactly. 'fms' is only exact with FMA3, without it the
+	// factors are split in halves (Veltkamp) whose products are exact. That split overflows for |a|, |b| near the max
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> MulError(ValuePack<ValTy, PackSize> a, ValuePack<ValTy, PackSize> b, ValuePack<ValTy, PackSize> p)
+	{
+		if constexpr (WRAPPERSIMD_FMA)
+			return fms(a, b, p);
+		else
+		{
+			static constexpr ValTy Splitter = static_cast<ValTy>((uint64_t{ 1 } << (MantissaBits<ValTy> / 2 + 1)) + 1);
+			ValuePack<ValTy, PackSize> ca = a * Splitter, cb = b * Splitter;
+			ValuePack<ValTy, PackSize> aHi = ca - (ca - a), bHi = cb - (cb - b);
+			ValuePack<ValTy, PackSize> aLo = a - aHi, bLo = b - bHi;
+			return ((aHi * bHi - p) + aHi * bLo + aLo * bHi) + aLo * bLo;
+		}
+	}
+
+	// log(x) for finite x > 0 as hi + lo, with lo holding the rounding error of hi.
+	// For pow, whose error is the absolute error of y * log(x), and so a plain Log's error scaled by y
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> LogHiLo(ValuePack<ValTy, PackSize> x, ValuePack<ValTy, PackSize>& lo)
+	{
+		using Pack = ValuePack<ValTy, PackSize>;
+
+		// ln(2) split as in ReduceLn2, so that e * Ln2Hi is exact for every exponent, subnormals included
+		static constexpr ValTy Ln2Hi = static_cast<ValTy>(0.693145751953125);
+		static constexpr ValTy Ln2Lo = static_cast<ValTy>(1.42860682030941723212e-6);
+
+		Pack e;
+		Pack m = SplitLogArg(x, e);
+
+		// s = f / d as s + sLo. f = m - 1 is exact, d = f + 2 is kept as d + dLo, and f - s * d is exact
+		Pack f = m - static_cast<ValTy>(1.0);
+		Pack d = f + static_cast<ValTy>(2.0);
+		Pack dLo = (Pack(static_cast<ValTy>(2.0)) - d) + f;
+		Pack s = f / d;
+		Pack sd = s * d;
+		Pack sLo = (((f - sd) - MulError(s, d, sd)) - s * dLo) / d;
+
+		// log(m) = 2s + 2s^3 / 3 + s^5 * Q(s^2). The cubic term is up to 1/100 of log(m), too much for Log's rounding
+		// error in it, so it is carried with its error too. Q is the atanh series, long enough to truncate unnoticed
+		static constexpr ValTy TwoThirds = static_cast<ValTy>(2.0 / 3.0);
+		static constexpr ValTy TwoThirdsLo = std::is_same_v<ValTy, float>
+			? static_cast<ValTy>(2.0 / 3.0 - static_cast<double>(static_cast<float>(2.0 / 3.0))) : static_cast<ValTy>(3.700743415417188e-17);
+		Pack z = s * s;
+		Pack zLo = MulError(s, s, z) + (s + s) * sLo;
+		Pack s3 = z * s;
+		Pack s3Lo = MulError(z, s, s3) + (zLo * s + z * sLo);
+		Pack cubic = s3 * TwoThirds;
+		Pack cubicLo = MulError(s3, Pack(TwoThirds), cubic) + (s3Lo * TwoThirds + s3 * TwoThirdsLo);
+		Pack tail;
+		if constexpr (std::is_same_v<ValTy, float>)
+			tail = s3 * z * Horner(z, 2.0 / 11, 2.0 / 9, 2.0 / 7, 2.0 / 5);
+		else
+			tail = s3 * z * Horner(z, 2.0 / 25, 2.0 / 23, 2.0 / 21, 2.0 / 19, 2.0 / 17, 2.0 / 15, 2.0 / 13, 2.0 / 11, 2.0 / 9, 2.0 / 7, 2.0 / 5);
+
+		// Each sum adds a term under 1/50 of the other, so its rounding error is exact
+		Pack twoS = s + s;
+		Pack odd = cubic + tail;
+		Pack logM = twoS + odd;
+		Pack logMLo = (((twoS - logM) + odd) + ((cubic - odd) + tail)) + ((sLo + sLo) + cubicLo);
+
+		// log(x) = e * ln(2) + log(m), the leading sum's error found without knowing which term is larger
+		Pack eLn2 = e * Ln2Hi;
+		Pack hi = eLn2 + logM;
+		Pack fromLogM = hi - eLn2;
+		Pack sumError = (eLn2 - (hi - fromLogM)) + (logM - fromLogM);
+		lo = sumError + fma(e, Pack(Ln2Lo), logMLo);
+		return hi;
+	}
+
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> Log1p(ValuePack<ValTy, PackSize> x)
+	{
+		// log(1 + x) * x / ((1 + x) - 1) cancels the rounding error made when forming 1 + x
+		ValuePack<ValTy, PackSize> u = x + static_cast<ValTy>(1.0);
+		ValuePack<ValTy, PackSize> ret = Log(u) * (x / (u - static_cast<ValTy>(1.0)));
+		ret = select(u == static_cast<ValTy>(1.0), x, ret);
+		return select(x == std::numeric_limits<ValTy>::infinity(), x, ret);
+	}
+
+	// Bits of 2 / pi after the binary point, 32 at a time
+	inline constexpr uint32_t TwoOverPiBits[] = {
+		0xA2F9836E, 0x4E441529, 0xFC2757D1, 0xF534DDC0, 0xDB629599, 0x3C439041, 0xFE5163AB, 0xDEBBC561,
+		0xB7246E3A, 0x424DD2E0, 0x06492EEA, 0x09D1921C, 0xFE1DEB1C, 0xB129A73E, 0xE88235F5, 0x2EBB4484,
+		0xE99C7026, 0xB45F7E41, 0x3991D639, 0x835339F4, 0x9C845F8B, 0xBDF9283B, 0x1FF897FF, 0xDE05980F,
+		0xEF2F118B, 0x5A0A6D1F, 0x6D367ECF, 0x27CB09B7, 0x4F463F66, 0x9E5FEA2D, 0x7527BAC7, 0xEBE5F17B,
+		0x3D0739F7, 0x8A5292EA, 0x6BFB5FB1, 0x1F8D5D08, 0x56033046, 0xFC7B6BAB, 0xF0CFBC20, 0x9AF4361D
+	};
+
+	// Payne-Hanek reduction of a finite x >= 8192 to r = x - q * pi / 2, |r| <= pi / 4, for arguments too large to
+	// reduce with a split pi / 2. Multiplies the 53 bit mantissa by the 224 bits of 2 / pi that can affect q mod 4 and
+	// the fraction, skipping the leading bits whose products are multiples of 4
+	inline double ReducePiOver2Large(double x, int& q)
+	{
+		static constexpr int WindowLimbs = 7;
+
+		int exp;
+		uint64_t m = static_cast<uint64_t>(std::ldexp(std::frexp(x, &exp), 53));
+		int e = exp - 53;
+		int skip = e >= 2 ? (e - 2) / 32 : 0;
+		// x * 2 / pi = p * 2^-point, with 'point' at least 128 bits above the lowest bit of p
+		int point = 32 * WindowLimbs - (e - 32 * skip);
+
+		uint32_t window[WindowLimbs];
+		for (int j = 0; j < WindowLimbs; j++)
+			window[j] = TwoOverPiBits[skip + WindowLimbs - 1 - j];
+
+		uint32_t p[WindowLimbs + 4] = {};
+		uint32_t mLimbs[2] = { static_cast<uint32_t>(m), static_cast<uint32_t>(m >> 32) };
+		for (int i = 0; i < 2; i++)
+		{
+			uint64_t carry = 0;
+			for (int j = 0; j < WindowLimbs; j++)
+			{
+				uint64_t t = uint64_t{ mLimbs[i] } * window[j] + p[i + j] + carry;
+				p[i + j] = static_cast<uint32_t>(t);
+				carry = t >> 32;
+			}
+			p[i + WindowLimbs] = static_cast<uint32_t>(carry);
+		}
+
+		// The 64 bits of p from bit 'pos' up
+		auto bits = [&](int pos)
+		{
+			int limb = pos / 32, shift = pos % 32;
+			uint64_t low = p[limb] | (uint64_t{ p[limb + 1] } << 32);
+			return shift ? (low >> shift) | (uint64_t{ p[limb + 2] } << (64 - shift)) : low;
+		};
+		q = static_cast<int>(bits(point) & 3);
+		uint64_t hi = bits(point - 64);
+		uint64_t lo = bits(point - 128);
+
+		// Round q to nearest, leaving a fraction in [-1/2, 1/2]
+		double sign = 1.0;
+		if (hi >> 63)
+		{
+			q = (q + 1) & 3;
+			lo = ~lo + 1;
+			hi = ~hi + (lo == 0);
+			sign = -1.0;
+		}
+		// The fraction as fracHi + fracLo, multiplied by pi / 2 keeping the rounding error of the leading product
+		static constexpr double PiOver2Hi = 1.57079632679489655800e0;
+		static constexpr double PiOver2Lo = 6.12323399573676603587e-17;
+		double hiRounded = static_cast<double>(hi);
+		int64_t hiError = static_cast<int64_t>(hi - static_cast<uint64_t>(hiRounded));
+		double fracHi = std::ldexp(hiRounded, -64);
+		double fracLo = std::ldexp(static_cast<double>(hiError), -64) + std::ldexp(static_cast<double>(lo), -128);
+		double rHi = fracHi * PiOver2Hi;
+		double rLo = std::fma(fracHi, PiOver2Hi, -rHi) + (fracHi * PiOver2Lo + fracLo * PiOver2Hi);
+		return sign * (rHi + rLo);
+	}
+
+	// Reduces x to r = x - q * pi / 2, |r| <= pi / 4, returning q
+	// pi / 2 is split into parts short enough that each product with q is exact. That stops being enough above
+	// 'Threshold', where lanes are reduced one at a time by ReducePiOver2Large and q is only correct mod 4
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> ReducePiOver2(ValuePack<ValTy, PackSize> x, ValuePack<ValTy, PackSize>& r)
+	{
+		using Pack = ValuePack<ValTy, PackSize>;
+		static constexpr ValTy Threshold = std::is_same_v<ValTy, float> ? static_cast<ValTy>(8192.0) : static_cast<ValTy>(1073741824.0);
+
+		Pack q = rint(x * static_cast<ValTy>(0.63661977236758134308));
+		if constexpr (std::is_same_v<ValTy, float>)
+			r = fnma(q, Pack(2.563344068257089600e-12f), fnma(q, Pack(7.549533620476722717e-8f), fnma(q, Pack(4.837512969970703125e-4f), fnma(q, Pack(1.5703125f), x))));
+		else
+			r = fnma(q, Pack(5.39030285815811905290e-15), fnma(q, Pack(7.54978941586159635335e-8), fnma(q, Pack(1.57079625129699707031e0), x)));
+
+		// Infinities are left to the fast path, which turns them into NaN
+		BoolPack<PackSize, sizeof(ValTy)> large = (x >= Threshold) && (x <= std::numeric_limits<ValTy>::max());
+		if (large.Any()) [[unlikely]]
+		{
+			for (size_t i = 0; i < PackSize; i++)
+			{
+				if (!large[i]) continue;
+				int quadrant;
+				r[i] = static_cast<ValTy>(ReducePiOver2Large(x[i], quadrant));
+				q[i] = static_cast<ValTy>(quadrant);
+			}
+		}
+		return q;
+	}
+
+	// sin(r) for |r| <= pi / 4
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> SinPoly(ValuePack<ValTy, PackSize> r)
+	{
+		ValuePack<ValTy, PackSize> z = r * r;
+		ValuePack<ValTy, PackSize> poly;
+		if constexpr (std::is_same_v<ValTy, float>)
+			poly = Horner(z, -1.9515295891e-4, 8.3321608736e-3, -1.6666654611e-1);
+		else
+			poly = Horner(z, 1.58962301576546568060e-10, -2.50507477628578072866e-8, 2.75573136213857245213e-6,
+				-1.98412698295895385996e-4, 8.33333333332211858878e-3, -1.66666666666666307295e-1);
+		return fma(r * z, poly, r);
+	}
+
+	// cos(r) for |r| <= pi / 4
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> CosPoly(ValuePack<ValTy, PackSize> r)
+	{
+		ValuePack<ValTy, PackSize> z = r * r;
+		ValuePack<ValTy, PackSize> poly;
+		if constexpr (std::is_same_v<ValTy, float>)
+			poly = Horner(z, 2.443315711809948e-5, -1.388731625493765e-3, 4.166664568298827e-2);
+		else
+			poly = Horner(z, -1.13585365213876817300e-11, 2.08757008419747316778e-9, -2.75573141792967388112e-7,
+				2.48015872888517045348e-5, -1.38888888888730564116e-3, 4.16666666666665929218e-2);
+		return fms(z * z, poly, z * static_cast<ValTy>(0.5)) + static_cast<ValTy>(1.0);
+	}
+
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> Atan(ValuePack<ValTy, PackSize> x)
+	{
+		using Pack = ValuePack<ValTy, PackSize>;
+		static constexpr ValTy PiOver2 = std::numbers::pi_v<ValTy> * static_cast<ValTy>(0.5);
+		static constexpr ValTy PiOver4 = std::numbers::pi_v<ValTy> * static_cast<ValTy>(0.25);
+
+		Pack a = abs(x);
+
+		// Reduce to |xr| <= tan(pi / 8) (float), or |xr| <= 0.66 (double)
+		static constexpr ValTy MidThreshold = std::is_same_v<ValTy, float> ? static_cast<ValTy>(0.41421356237309504880) : static_cast<ValTy>(0.66);
+		BoolPack<PackSize, sizeof(ValTy)> big = a > static_cast<ValTy>(2.41421356237309504880);
+		BoolPack<PackSize, sizeof(ValTy)> mid = a > MidThreshold;
+		Pack offset = select(big, Pack(PiOver2), select(mid, Pack(PiOver4), Pack(static_cast<ValTy>(0.0))));
+		Pack xr = select(big, Pack(static_cast<ValTy>(-1.0)) / a,
+			select(mid, (a - static_cast<ValTy>(1.0)) / (a + static_cast<ValTy>(1.0)), a));
+
+		Pack z = xr * xr;
+		Pack ret;
+		if constexpr (std::is_same_v<ValTy, float>)
+		{
+			ret = offset + (Horner(z, 8.05374449538e-2, -1.38776856032e-1, 1.99777106478e-1, -3.33329491539e-1) * z * xr + xr);
+		}
+		else
+		{
+			Pack p = Horner(z, -8.750608600031904122785e-1, -1.615753718733365076637e1, -7.500855792314704667340e1,
+				-1.228866684490136173410e2, -6.485021904942025371773e1);
+			Pack q = Horner(z, 1.0, 2.485846490142306297962e1, 1.650270098316988542046e2, 4.328810604912902668951e2,
+				4.853903996359136964868e2, 1.945506571482613964425e2);
+
+			// The offsets are rounded, add back the bits that were lost
+			static constexpr double MoreBits = 6.123233995736765886130e-17;
+			Pack correction = select(big, Pack(MoreBits), select(mid, Pack(MoreBits * 0.5), Pack(0.0)));
+			ret = offset + ((xr * (z * p / q) + xr) + correction);
+		}
+
+		return ret ^ SignBit(x);
+	}
+
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> Erf(ValuePack<ValTy, PackSize> x)
+	{
+		using Pack = ValuePack<ValTy, PackSize>;
+		Pack a = abs(x);
+
+		// |x| < 1: x * T(x^2) / U(x^2)
+		Pack z = x * x;
+		Pack small = x * Horner(z, 9.60497373987051638749e0, 9.00260197203842689217e1, 2.23200534594684319226e3,
+			7.00332514112805075473e3, 5.55923013010394962768e4)
+			/ Horner(z, 1.0, 3.35617141647503099647e1, 5.21357949780152679795e2, 4.59432382970980127987e3,
+				2.26290000613890934246e4, 4.92673942608635921086e4);
+
+		// |x| >= 1: 1 - erfc(|x|), erfc(x) = e^(-x^2) * P(x) / Q(x), clamped where 1 - erfc(x) rounds to 1
+		static constexpr ValTy Saturate = std::is_same_v<ValTy, float> ? static_cast<ValTy>(4.0) : static_cast<ValTy>(6.0);
+		Pack ac = min(Pack(Saturate), a);
+		Pack erfc = Exp(-(ac * ac)) * Horner(ac, 2.46196981473530512524e-10, 5.64189564831068821977e-1, 7.46321056442269912687e0,
+			4.86371970985681366614e1, 1.96520832956077098242e2, 5.26445194995477358631e2, 9.34528527171957607540e2,
+			1.02755188689515710272e3, 5.57535335369399327526e2)
+			/ Horner(ac, 1.0, 1.32281951154744992508e1, 8.67072140885989742329e1, 3.54937778887819891062e2,
+				9.75708501743205489753e2, 1.82390916687909736289e3, 2.24633760818710981792e3, 1.65666309194161350182e3,
+				5.57535340817727675546e2);
+		Pack large = (Pack(static_cast<ValTy>(1.0)) - erfc) | SignBit(x);
+
+		return select(a < static_cast<ValTy>(1.0), small, large);
+	}
+}
+
+// === Trig functions ===
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> sin(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "sin requires a floating point pack");
+	// sin is odd, reduce |x| and restore the sign afterwards
+	ValuePack<ValTy, PackSize> r;
+	ValuePack<ValTy, PackSize> q = detail::ReducePiOver2(abs(pack), r);
+
+	// Odd quadrants use the cosine polynomial, the lower half plane is negated
+	ValuePack<ValTy, PackSize> ret = select(detail::BitSet(q, 0), detail::CosPoly(r), detail::SinPoly(r));
+	return ret ^ detail::BitToSign(q, 1) ^ detail::SignBit(pack);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> cos(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "cos requires a floating point pack");
+	ValuePack<ValTy, PackSize> r;
+	ValuePack<ValTy, PackSize> q = detail::ReducePiOver2(abs(pack), r) + static_cast<ValTy>(1.0);
+
+	// cos(x) = sin(x + pi / 2)
+	ValuePack<ValTy, PackSize> ret = select(detail::BitSet(q, 0), detail::CosPoly(r), detail::SinPoly(r));
+	return ret ^ detail::BitToSign(q, 1);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> tan(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "tan requires a floating point pack");
+	ValuePack<ValTy, PackSize> r;
+	ValuePack<ValTy, PackSize> q = detail::ReducePiOver2(abs(pack), r);
+	ValuePack<ValTy, PackSize> sinR = detail::SinPoly(r);
+	ValuePack<ValTy, PackSize> cosR = detail::CosPoly(r);
+
+	// Odd quadrants: tan(r + pi / 2) = -cos(r) / sin(r)
+	BoolPack<PackSize, sizeof(ValTy)> odd = detail::BitSet(q, 0);
+	return (select(odd, cosR, sinR) / select(odd, sinR, cosR)) ^ detail::BitToSign(q, 0) ^ detail::SignBit(pack);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> asin(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "asin requires a floating point pack");
+	ValuePack<ValTy, PackSize> one = static_cast<ValTy>(1.0);
+	return detail::Atan(pack / sqrt((one - pack) * (one + pack)));
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> acos(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "acos requires a floating point pack");
+	ValuePack<ValTy, PackSize> one = static_cast<ValTy>(1.0);
+	return detail::Atan(sqrt((one - pack) / (one + pack))) * static_cast<ValTy>(2.0);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> atan(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "atan requires a floating point pack");
+	return detail::Atan(pack);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> atan2(ValuePack<ValTy, PackSize> pack1, ValuePack<ValTy, PackSize> pack2)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "atan2 requires a floating point pack");
+	using Pack = ValuePack<ValTy, PackSize>;
+	using IntTy = detail::MathIntTy<ValTy>;
+	static constexpr ValTy Pi = std::numbers::pi_v<ValTy>;
+	static constexpr ValTy Inf = std::numeric_limits<ValTy>::infinity();
+
+	// pack1 = y, pack2 = x
+	Pack ySign = detail::SignBit(pack1);
+	BoolPack<PackSize, sizeof(ValTy)> xNegative = ValuePack<IntTy, PackSize>(0) > pack2.template Cast<IntTy>();
+	Pack ret = detail::Atan(pack1 / pack2);
+	ret = select(xNegative, ret + (Pack(Pi) ^ ySign), ret);
+
+	// 0 / 0 and inf / inf are handled explicitly
+	Pack zeroRet = select(xNegative, Pack(Pi), Pack(static_cast<ValTy>(0.0))) ^ ySign;
+	Pack infRet = select(xNegative, Pack(Pi * static_cast<ValTy>(0.75)), Pack(Pi * static_cast<ValTy>(0.25))) ^ ySign;
+	ret = select((pack1 == static_cast<ValTy>(0.0)) && (pack2 == static_cast<ValTy>(0.0)), zeroRet, ret);
+	return select((abs(pack1) == Inf) && (abs(pack2) == Inf), infRet, ret);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> sinh(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "sinh requires a floating point pack");
+	ValuePack<ValTy, PackSize> a = abs(pack);
+
+	// sinh(a) = (E + E / (E + 1)) / 2 where E = e^a - 1
+	ValuePack<ValTy, PackSize> e = detail::ExpM1(min(ValuePack<ValTy, PackSize>(detail::HyperbolicCutoff<ValTy>), a));
+	ValuePack<ValTy, PackSize> ret = (e + e / (e + static_cast<ValTy>(1.0))) * static_cast<ValTy>(0.5);
+	ret = select(a > detail::HyperbolicCutoff<ValTy>, detail::HalfExp(a), ret);
+	return ret ^ detail::SignBit(pack);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> cosh(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "cosh requires a floating point pack");
+	ValuePack<ValTy, PackSize> a = abs(pack);
+	ValuePack<ValTy, PackSize> e = detail::Exp(min(ValuePack<ValTy, PackSize>(detail::HyperbolicCutoff<ValTy>), a));
+	ValuePack<ValTy, PackSize> ret = (e + ValuePack<ValTy, PackSize>(static_cast<ValTy>(1.0)) / e) * static_cast<ValTy>(0.5);
+	return select(a > detail::HyperbolicCutoff<ValTy>, detail::HalfExp(a), ret);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> tanh(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "tanh requires a floating point pack");
+
+	// tanh(a) = E / (E + 2) where E = e^2a - 1
+	ValuePack<ValTy, PackSize> a = min(ValuePack<ValTy, PackSize>(detail::HyperbolicCutoff<ValTy>), abs(pack));
+	ValuePack<ValTy, PackSize> e = detail::ExpM1(a + a);
+	return (e / (e + static_cast<ValTy>(2.0))) ^ detail::SignBit(pack);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> asinh(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "asinh requires a floating point pack");
+	static constexpr ValTy One = static_cast<ValTy>(1.0);
+	ValuePack<ValTy, PackSize> a = abs(pack);
+
+	// asinh(a) = log1p(a + a^2 / (1 + sqrt(1 + a^2)))
+	ValuePack<ValTy, PackSize> a2 = a * a;
+	ValuePack<ValTy, PackSize> ret = detail::Log1p(a + a2 / (sqrt(a2 + One) + One));
+	ret = select(a > detail::InvHyperbolicCutoff<ValTy>, detail::Log(a) + std::numbers::ln2_v<ValTy>, ret);
+	return ret ^ detail::SignBit(pack);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> acosh(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "acosh requires a floating point pack");
+	static constexpr ValTy One = static_cast<ValTy>(1.0);
+
+	// acosh(x) = log1p((x - 1) + sqrt((x - 1) * (x + 1)))
+	ValuePack<ValTy, PackSize> xm1 = pack - One;
+	ValuePack<ValTy, PackSize> ret = detail::Log1p(xm1 + sqrt(xm1 * (pack + One)));
+	ret = select(pack > detail::InvHyperbolicCutoff<ValTy>, detail::Log(pack) + std::numbers::ln2_v<ValTy>, ret);
+	return select(pack < One, ValuePack<ValTy, PackSize>(std::numeric_limits<ValTy>::quiet_NaN()), ret);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> atanh(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "atanh requires a floating point pack");
+
+	// atanh(a) = log1p(2a / (1 - a)) / 2
+	ValuePack<ValTy, PackSize> a = abs(pack);
+	ValuePack<ValTy, PackSize> ret = detail::Log1p((a + a) / (ValuePack<ValTy, PackSize>(static_cast<ValTy>(1.0)) - a)) * static_cast<ValTy>(0.5);
+	return ret ^ detail::SignBit(pack);
+}
+
+// === Exp functions ===
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> exp(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "exp requires a floating point pack");
+	return detail::Exp(pack);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> log(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "log requires a floating point pack");
+	return detail::Log(pack);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> log2(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "log2 requires a floating point pack");
+	return detail::Log(pack) * std::numbers::log2e_v<ValTy>;
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> log10(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "log10 requires a floating point pack");
+	return detail::Log(pack) * std::numbers::log10e_v<ValTy>;
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> cbrt(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "cbrt requires a floating point pack");
+	using Pack = ValuePack<ValTy, PackSize>;
+	static constexpr ValTy Inf = std::numeric_limits<ValTy>::infinity();
+
+	// Estimate as e^(log(a) / 3), then refine with one Newton step
+	Pack a = abs(pack);
+	Pack y = detail::Exp(detail::Log(a) * static_cast<ValTy>(1.0 / 3.0));
+	y = y + (a / (y * y) - y) * static_cast<ValTy>(1.0 / 3.0);
+
+	// Zeroes, infinities and NaN are returned unchanged
+	y = select((a == static_cast<ValTy>(0.0)) || (a == Inf) || !(a == a), a, y);
+	return y ^ detail::SignBit(pack);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> invsqrt(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "invsqrt requires a floating point pack");
+	return ValuePack<ValTy, PackSize>(static_cast<ValTy>(1.0)) / sqrt(pack);
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> invcbrt(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "invcbrt requires a floating point pack");
+	return ValuePack<ValTy, PackSize>(static_cast<ValTy>(1.0)) / cbrt(pack);
+}
+
+// Computed as e^(y * log(x)), with log(x) and its product with y each carried as a value and its rounding error
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> pow(ValuePack<ValTy, PackSize> pack1, ValuePack<ValTy, PackSize> pack2)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "pow requires a floating point pack");
+	using Pack = ValuePack<ValTy, PackSize>;
+	static constexpr ValTy One = static_cast<ValTy>(1.0);
+	static constexpr ValTy Inf = std::numeric_limits<ValTy>::infinity();
+
+	// pack1 = x, pack2 = y
+	// Zero, infinite and NaN x take log(x) = -inf, inf or NaN, with no error term. Neither does y * log(x) for |x| = 1, or so
+	// large that the result is zero or infinite anyway, which also keeps MulError from overflowing for huge y
+	Pack a = abs(pack1);
+	Pack logLo;
+	Pack logHi = detail::LogHiLo(a, logLo);
+	BoolPack<PackSize, sizeof(ValTy)> finite = (a > static_cast<ValTy>(0.0)) && (a < Inf);
+	logHi = select(finite, logHi, select(a == static_cast<ValTy>(0.0), Pack(-Inf), a));
+	logLo = select(finite, logLo, Pack(static_cast<ValTy>(0.0)));
+	Pack t = pack2 * logHi;
+	Pack tLo = detail::MulError(pack2, logHi, t) + pack2 * logLo;
+	BoolPack<PackSize, sizeof(ValTy)> inRange = (abs(t) < static_cast<ValTy>(std::numeric_limits<ValTy>::max_exponent)) && !(logHi == static_cast<ValTy>(0.0));
+	tLo = select(inRange, tLo, Pack(static_cast<ValTy>(0.0)));
+	Pack ret = detail::Exp(t, tLo);
+
+	// Negative finite x: only integer y have a real result, negative when y is odd
+	Pack halfY = pack2 * static_cast<ValTy>(0.5);
+	BoolPack<PackSize, sizeof(ValTy)> yInteger = rint(pack2) == pack2;
+	BoolPack<PackSize, sizeof(ValTy)> yOdd = yInteger && !(rint(halfY) == halfY);
+	Pack negRet = select(yInteger || (pack1 == -Inf), ret ^ (detail::SignBit(pack1) & yOdd.template Cast<ValTy>()),
+		Pack(std::numeric_limits<ValTy>::quiet_NaN()));
+	ret = select(pack1 < static_cast<ValTy>(0.0), negRet, ret);
+
+	// Signed zero keeps its sign for odd y
+	ret = select(pack1 == static_cast<ValTy>(0.0), ret | (detail::SignBit(pack1) & yOdd.template Cast<ValTy>()), ret);
+
+	// x^0 = 1^y = (-1)^inf = 1, even for NaN
+	BoolPack<PackSize, sizeof(ValTy)> one = (pack2 == static_cast<ValTy>(0.0)) || (pack1 == One) || ((pack1 == -One) && (abs(pack2) == Inf));
+	return select(one, Pack(One), ret);
+}
+
+// === Special functions ===
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> erf(ValuePack<ValTy, PackSize> pack)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "erf requires a floating point pack");
+	return detail::Erf(pack);
+}
+} // namespace WRAPPERSIMD_TARGET
\ No newline at end of file
@@ -0,0 +1,401 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+// Aggregated timings of named scopes, recorded by TIME_SCOPE and STOP_LOG (see Timer.h):
+//
+//	void Step()
+//	{
+//		TIME_SCOPE(step);
+//		...
+//	}
+//
+// Every scope with the same name adds to the same count, total and histogram of durations, which has a bucket per
+// power of two. Each thread records into counters of its own, so recording takes no locks and no atomic
+// read-modify-writes. Snapshot() merges the counters of every thread, including threads which have exited.
+// At exit, the timings are printed, or written to the file given to DumpAtExit(), as CSV if it ends in ".csv" and as
+// JSON otherwise.
+// Durations are read from the time stamp counter without fences, so they are only accurate to a few tens of cycles,
+// and converted to nanoseconds with the TSC frequency measured against steady_clock over the life of the registry.
+
+using ProfileScopeId = uint32_t;
+
+// Timings of one scope
+struct ProfileStats
+{
+	// Bucket 0 holds durations of 0 ticks, and bucket b > 0 those in [2^(b - 1), 2^b)
+	static constexpr size_t NumBuckets = 65;
+
+	std::string name;
+	uint64_t count = 0;
+	uint64_t ticks = 0;
+	std::array<uint64_t, NumBuckets> histogram{};
+	double nsPerTick = 0.0;
+
+	double TotalNs() const { return static_cast<double>(ticks) * nsPerTick; }
+	double MeanNs() const { return count ? TotalNs() / static_cast<double>(count) : 0.0; }
+
+	// Upper bound of the bucket holding the 'p'th percentile, 'p' in [0, 100]
+	double PercentileNs(double p) const
+	{
+		if (count == 0) return 0.0;
+		uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(count))));
+		uint64_t seen = 0;
+		for (size_t b = 0; b < NumBuckets; b++)
+		{
+			seen += histogram[b];
+			if (seen >= rank) return b == 0 ? 0.0 : std::ldexp(nsPerTick, static_cast<int>(b));
+		}
+		return std::ldexp(nsPerTick, NumBuckets - 1);
+	}
+
+	// Adds the timings of 'other', which should be of the same scope
+	void Merge(const ProfileStats& other)
+	{
+		count += other.count;
+		ticks += other.ticks;
+		for (size_t b = 0; b < NumBuckets; b++)
+			histogram[b] += other.histogram[b];
+	}
+};
+
+class ProfileRegistry
+{
+public:
+	static constexpr ProfileScopeId MaxScopes = 1024;
+
+	// Never destroyed, so threads which exit after main() returns can still record and retire their counters
+	static ProfileRegistry& Instance()
+	{
+		static ProfileRegistry* registry = new ProfileRegistry();
+		return *registry;
+	}
+
+	// Id of the scope called 'name', the same for every call with the same name. Past MaxScopes names, returns an
+	// id which records nothing
+	ProfileScopeId Register(std::string_view name)
+	{
+		std::lock_guard lock(mutex);
+		auto [it, inserted] = ids.try_emplace(std::string(name), static_cast<ProfileScopeId>(names.size()));
+		if (inserted) names.push_back(it->first);
+		return it->second;
+	}
+
+	// Adds a duration of 'ticks' to scope 'id', on the calling thread's counters
+	static void Record(ProfileScopeId id, uint64_t ticks)
+	{
+		if (id >= MaxScopes) return;
+		Slot& slot = LocalSlot(id);
+		Add(slot.count, 1);
+		Add(slot.ticks, ticks);
+		Add(slot.histogram[std::bit_width(ticks)], 1);
+	}
+
+	// Timings of every scope recorded on any thread. Counters of running threads are read while they may be
+	// recording, so the fields of a scope can be a few records apart
+	std::vector<ProfileStats> Snapshot()
+	{
+		std::lock_guard lock(mutex);
+		std::vector<ProfileStats> stats = retired;
+		stats.resize(names.size());
+		for (ThreadCounters* counters : threads)
+			AddCounters(stats, *counters);
+		return Finish(std::move(stats));
+	}
+
+	// Timings recorded on the calling thread
+	std::vector<ProfileStats> ThreadSnapshot()
+	{
+		std::lock_guard lock(mutex);
+		std::vector<ProfileStats> stats(names.size());
+		if (handle.counters) AddCounters(stats, *handle.counters);
+		return Finish(std::move(stats));
+	}
+
+	// Writes the timings to 'path' at exit instead of printing them
+	void DumpAtExit(std::string path)
+	{
+		std::lock_guard lock(mutex);
+		dumpPath = std::move(path);
+	}
+
+	static void WriteJson(std::ostream& out, const std::vector<ProfileStats>& stats)
+	{
+		out << "{\n  \"scopes\": [\n";
+		for (size_t i = 0; i < stats.size(); i++)
+		{
+			const ProfileStats& s = stats[i];
+			out << "    { \"name\": \"" << Escape(s.name) << "\", \"count\": " << s.count << ", \"total_ns\": " << s.TotalNs()
+				<< ", \"mean_ns\": " << s.MeanNs() << ", \"p50_ns\": " << s.PercentileNs(50) << ", \"p99_ns\": " << s.PercentileNs(99)
+				<< ", \"histogram\": [";
+			bool first = true;
+			for (size_t b = 0; b < ProfileStats::NumBuckets; b++)
+			{
+				if (s.histogram[b] == 0) continue;
+				out << (first ? "" : ", ") << "{ \"below_ns\": " << (b == 0 ? 0.0 : std::ldexp(s.nsPerTick, static_cast<int>(b)))
+					<< ", \"count\": " << s.histogram[b] << " }";
+				first = false;
+			}
+			out << "] }" << (i + 1 < stats.size() ? "," : "") << '\n';
+		}
+		out << "  ]\n}\n";
+	}
+
+	// One row per scope, with the histogram in columns hist_0 to hist_64, bucketed by TSC ticks as in ProfileStats
+	static void WriteCsv(std::ostream& out, const std::vector<ProfileStats>& stats)
+	{
+		out << "name,count,total_ns,mean_ns,p50_ns,p99_ns,ns_per_tick";
+		for (size_t b = 0; b < ProfileStats::NumBuckets; b++)
+			out << ",hist_" << b;
+		out << '\n';
+
+		for (const ProfileStats& s : stats)
+		{
+			out << '"' << s.name << "\"," << s.count << ',' << s.TotalNs() << ',' << s.MeanNs() << ',' << s.PercentileNs(50)
+				<< ',' << s.PercentileNs(99) << ',' << s.nsPerTick;
+			for (uint64_t n : s.histogram)
+				out << ',' << n;
+			out << '\n';
+		}
+	}
+
+	static void PrintSummary(std::ostream& out, const std::vector<ProfileStats>& stats)
+	{
+		out << std::left << std::setw(32) << "scope" << std::right << std::setw(12) << "count" << std::setw(14) << "total ms"
+			<< std::setw(12) << "mean ns" << std::setw(12) << "p50 ns" << std::setw(12) << "p99 ns" << '\n';
+		for (const ProfileStats& s : stats)
+		{
+			out << std::left << std::setw(32) << s.name << std::right << std::setw(12) << s.count << std::fixed << std::setprecision(3)
+				<< std::setw(14) << s.TotalNs() / 1e6 << std::setprecision(1) << std::setw(12) << s.MeanNs()
+				<< std::setw(12) << s.PercentileNs(50) << std::setw(12) << s.PercentileNs(99) << '\n';
+		}
+		out << std::defaultfloat;
+	}
+
+	ProfileRegistry(const ProfileRegistry&) = delete;
+	ProfileRegistry& operator=(const ProfileRegistry&) = delete;
+
+protected:
+	using Clock = std::chrono::steady_clock;
+
+	// Only the owning thread writes a slot, so its counters are incremented with a plain load and store
+	struct Slot
+	{
+		std::atomic<uint64_t> count{ 0 };
+		std::atomic<uint64_t> ticks{ 0 };
+		std::array<std::atomic<uint64_t>, ProfileStats::NumBuckets> histogram{};
+	};
+
+	// A thread's slots, allocated on the first record of each scope
+	struct ThreadCounters
+	{
+		std::array<std::atomic<Slot*>, MaxScopes> slots{};
+
+		~ThreadCounters()
+		{
+			for (std::atomic<Slot*>& slot : slots)
+				delete slot.load(std::memory_order_relaxed);
+		}
+	};
+
+	// Hands the calling thread's counters back to the registry when the thread exits
+	struct ThreadHandle
+	{
+		ThreadCounters* counters = nullptr;
+
+		~ThreadHandle()
+		{
+			if (counters) Instance().Retire(counters);
+		}
+	};
+
+	ProfileRegistry()
+		: startTime(Clock::now()), startTicks(__rdtsc())
+	{
+		std::atexit([] { Instance().DumpNow(); });
+	}
+
+	static void Add(std::atomic<uint64_t>& counter, uint64_t x)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + x, std::memory_order_relaxed);
+	}
+
+	static Slot& LocalSlot(ProfileScopeId id)
+	{
+		ThreadCounters* counters = handle.counters;
+		if (!counters) [[unlikely]] counters = Instance().Adopt();
+		Slot* slot = counters->slots[id].load(std::memory_order_relaxed);
+		if (!slot) [[unlikely]]
+		{
+			slot = new Slot();
+			counters->slots[id].store(slot, std::memory_order_release);
+		}
+		return *slot;
+	}
+
+	// Creates the calling thread's counters
+	ThreadCounters* Adopt()
+	{
+		ThreadCounters* counters = new ThreadCounters();
+		std::lock_guard lock(mutex);
+		threads.push_back(counters);
+		handle.counters = counters;
+		return counters;
+	}
+
+	// Folds the counters of an exiting thread into 'retired'
+	void Retire(ThreadCounters* counters)
+	{
+		std::lock_guard lock(mutex);
+		retired.resize(names.size());
+		AddCounters(retired, *counters);
+		threads.erase(std::find(threads.begin(), threads.end(), counters));
+		delete counters;
+	}
+
+	static void AddCounters(std::vector<ProfileStats>& stats, const ThreadCounters& counters)
+	{
+		for (size_t id = 0; id < stats.size() && id < MaxScopes; id++)
+		{
+			const Slot* slot = counters.slots[id].load(std::memory_order_acquire);
+			if (!slot) continue;
+
+			ProfileStats& s = stats[id];
+			s.count += slot->count.load(std::memory_order_relaxed);
+			s.ticks += slot->ticks.load(std::memory_order_relaxed);
+			for (size_t b = 0; b < ProfileStats::NumBuckets; b++)
+				s.histogram[b] += slot->histogram[b].load(std::memory_order_relaxed);
+		}
+	}
+
+	// Names the scopes, converts to nanoseconds and drops scopes without records. Needs 'mutex'
+	std::vector<ProfileStats> Finish(std::vector<ProfileStats> stats)
+	{
+		double nsPerTick = NsPerTick();
+		std::vector<ProfileStats> ret;
+		for (size_t id = 0; id < stats.size(); id++)
+		{
+			if (stats[id].count == 0) continue;
+			stats[id].name = names[id];
+			stats[id].nsPerTick = nsPerTick;
+			ret.push_back(std::move(stats[id]));
+		}
+		return ret;
+	}
+
+	// TSC period measured since the registry was created, waiting for at least 10ms to pass for a usable estimate
+	double NsPerTick() const
+	{
+		Clock::time_point now;
+		uint64_t ticks;
+		do
+		{
+			now = Clock::now();
+			ticks = __rdtsc();
+		} while (now - startTime < std::chrono::milliseconds(10));
+
+		std::chrono::duration<double, std::nano> elapsed = now - startTime;
+		return elapsed.count() / static_cast<double>(ticks - startTicks);
+	}
+
+	void DumpNow()
+	{
+		std::vector<ProfileStats> stats = Snapshot();
+		if (stats.empty()) return;
+
+		std::string path;
+		{
+			std::lock_guard lock(mutex);
+			path = dumpPath;
+		}
+
+		if (path.empty())
+		{
+			PrintSummary(std::cout, stats);
+			return;
+		}
+
+		std::ofstream out(path);
+		if (path.ends_with(".csv")) WriteCsv(out, stats);
+		else WriteJson(out, stats);
+	}
+
+	static std::string Escape(std::string_view text)
+	{
+		std::string ret;
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\') ret += '\\';
+			ret += c;
+		}
+		return ret;
+	}
+
+	std::mutex mutex;								// Guards the fields below
+	std::unordered_map<std::string, ProfileScopeId> ids;
+	std::vector<std::string> names;					// By id
+	std::vector<ThreadCounters*> threads;			// Counters of running threads
+	std::vector<ProfileStats> retired;				// Totals of exited threads, by id
+	std::string dumpPath;
+
+	const Clock::time_point startTime;
+	const uint64_t startTicks;
+
+	static thread_local ThreadHandle handle;
+};
+
+inline thread_local ProfileRegistry::ThreadHandle ProfileRegistry::handle;
+
+// Records the time from its construction to its destruction under a scope of the registry
+class ProfiledScope
+{
+public:
+	explicit ProfiledScope(ProfileScopeId id_)
+		: id(id_), begin(__rdtsc()) {}
+
+	// Registers the name 'NameFn' returns on first use. Every lambda has a type of its own, so each place that
+	// passes one keeps its own id, and later constructions skip the registry's lock
+	template <typename NameFn> requires std::is_invocable_r_v<std::string_view, NameFn>
+	explicit ProfiledScope(NameFn)
+		: ProfiledScope(RegisteredId<NameFn>()) {}
+
+	~ProfiledScope()
+	{
+		ProfileRegistry::Record(id, __rdtsc() - begin);
+	}
+
+	ProfiledScope(const ProfiledScope&) = delete;
+	ProfiledScope& operator=(const ProfiledScope&) = delete;
+
+protected:
+	template <typename NameFn>
+	static ProfileScopeId RegisteredId()
+	{
+		static const ProfileScopeId id = ProfileRegistry::Instance().Register(NameFn{}());
+		return id;
+	}
+
+	ProfileScopeId id;
+	uint64_t begin;
+};
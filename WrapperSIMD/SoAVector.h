@@ -0,0 +1,181 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "AlignedMemory.h"
+#include "ValuePack.h"
+#include "WidePack.h"
+
+// Growable structure of arrays: each field lives in its own cache line aligned array, padded to a whole number of packs.
+//
+//	SoAVector<float, float, float> particles;	// x, y, z
+//	particles.PushBack(1.0f, 2.0f, 3.0f);
+//	particles.ForEachPack([](auto& x, auto& y, auto& z) { x = fma(y, z, x); });
+//	std::span<float> xs = particles.Column<0>();
+//
+// ForEachPack hands the callable one pack per field, loaded from and stored back to aligned memory. Every pack holds
+// PackSize elements: the narrowest field fills one native register, and wider fields span several (see WidePack.h).
+// The last pack of the columns is always whole, so the loop has no tail. Lanes past Size() in it are padding: their
+// values are unspecified and anything written to them is discarded.
+
+inline namespace WRAPPERSIMD_TARGET
+{
+template <typename... Fields>
+class SoAVector
+{
+	static_assert(sizeof...(Fields) > 0, "SoAVector needs at least one field");
+	static_assert((... && std::is_arithmetic_v<Fields>), "SoAVector fields must be arithmetic types");
+
+public:
+	// Every field is processed with the same number of elements per pack, set by the smallest field
+	static constexpr size_t PackSize = NativeBytes / std::min({ sizeof(Fields)... });
+
+	static constexpr size_t Alignment = 64;
+
+	template <size_t I>
+	using FieldTy = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+	SoAVector() = default;
+
+	explicit SoAVector(size_t size_)
+	{
+		Resize(size_);
+	}
+
+	SoAVector(const SoAVector& other)
+	{
+		if (other.size == 0) return;
+		Reserve(other.size);
+		size = other.size;
+		ForEachColumn([&]<size_t I>() { std::memcpy(std::get<I>(columns), std::get<I>(other.columns), Padded(size) * sizeof(FieldTy<I>)); });
+	}
+
+	SoAVector(SoAVector&& other) noexcept
+		: columns(std::exchange(other.columns, {})), size(std::exchange(other.size, 0)), capacity(std::exchange(other.capacity, 0)) {}
+
+	SoAVector& operator=(SoAVector other) noexcept
+	{
+		std::swap(columns, other.columns);
+		std::swap(size, other.size);
+		std::swap(capacity, other.capacity);
+		return *this;
+	}
+
+	~SoAVector()
+	{
+		ForEachColumn([&]<size_t I>() { Free(std::get<I>(columns)); });
+	}
+
+	size_t Size() const { return size; }
+	size_t Capacity() const { return capacity; }
+	bool Empty() const { return size == 0; }
+
+	// The column of field 'I', which stays valid until the next reallocation
+	template <size_t I>
+	std::span<FieldTy<I>> Column() { return { std::get<I>(columns), size }; }
+
+	template <size_t I>
+	std::span<const FieldTy<I>> Column() const { return { std::get<I>(columns), size }; }
+
+	// Makes room for at least 'n' elements, without changing the size
+	void Reserve(size_t n)
+	{
+		if (n <= capacity) return;
+		n = Padded(n);
+
+		ForEachColumn([&]<size_t I>()
+		{
+			using T = FieldTy<I>;
+			T* data = AlignedAllocator<T, Alignment>().allocate(n);
+			if (std::get<I>(columns))
+			{
+				std::memcpy(data, std::get<I>(columns), Padded(size) * sizeof(T));
+				Free(std::get<I>(columns));
+			}
+			std::get<I>(columns) = data;
+		});
+		capacity = n;
+	}
+
+	// New elements are zeroed
+	void Resize(size_t n)
+	{
+		if (n > capacity) Reserve(std::max(n, 2 * capacity));
+		if (n > size)
+			ForEachColumn([&]<size_t I>() { std::memset(std::get<I>(columns) + size, 0, (n - size) * sizeof(FieldTy<I>)); });
+		size = n;
+	}
+
+	void PushBack(Fields... values)
+	{
+		if (size == capacity) Reserve(std::max(2 * capacity, PackSize));
+		[&]<size_t... Is>(std::index_sequence<Is...>)
+		{
+			((std::get<Is>(columns)[size] = values), ...);
+		}(std::index_sequence_for<Fields...>());
+		size++;
+	}
+
+	void Clear()
+	{
+		size = 0;
+	}
+
+	// Calls 'func(ValuePack<Fields, PackSize>&...)' for every pack of elements, storing the packs back afterwards
+	template <typename Func>
+	void ForEachPack(Func&& func)
+	{
+		[&]<size_t... Is>(std::index_sequence<Is...>)
+		{
+			for (size_t i = 0; i < size; i += PackSize)
+			{
+				std::tuple<ValuePack<Fields, PackSize>...> packs{ ValuePack<Fields, PackSize>::Load(std::get<Is>(columns) + i)... };
+				func(std::get<Is>(packs)...);
+				(std::get<Is>(packs).Store(std::get<Is>(columns) + i), ...);
+			}
+		}(std::index_sequence_for<Fields...>());
+	}
+
+	// Calls 'func(ValuePack<Fields, PackSize>...)' for every pack of elements
+	template <typename Func>
+	void ForEachPack(Func&& func) const
+	{
+		[&]<size_t... Is>(std::index_sequence<Is...>)
+		{
+			for (size_t i = 0; i < size; i += PackSize)
+				func(ValuePack<Fields, PackSize>::Load(std::get<Is>(columns) + i)...);
+		}(std::index_sequence_for<Fields...>());
+	}
+
+protected:
+	static size_t Padded(size_t n)
+	{
+		return (n + PackSize - 1) / PackSize * PackSize;
+	}
+
+	template <typename T>
+	static void Free(T* data)
+	{
+		if (data) AlignedAllocator<T, Alignment>().deallocate(data, 0);
+	}
+
+	template <typename Func>
+	static void ForEachColumn(Func&& func)
+	{
+		[&]<size_t... Is>(std::index_sequence<Is...>)
+		{
+			(func.template operator()<Is>(), ...);
+		}(std::index_sequence_for<Fields...>());
+	}
+
+	std::tuple<Fields*...> columns{};
+	size_t size = 0;
+	size_t capacity = 0;
+};
+} // namespace WRAPPERSIMD_TARGET
@@ -0,0 +1,321 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "Algorithms.h"
+#include "ValuePack.h"
+
+// Work-stealing thread pool and parallel versions of the array algorithms.
+//
+//	simd::parallel_transform(std::span<const float>(in), std::span<float>(out), [](auto x) { return x * x + 1.0f; });
+//	float total = simd::parallel_reduce(std::span<const float>(in), 0.0f, [](auto a, auto b) { return a + b; });
+//
+// Arrays are split into chunks that fit in L2 and are whole packs and whole cache lines long, and each chunk is
+// processed by the single threaded algorithm. Chunk boundaries fall on cache lines of the output, so no two threads
+// write to the same line.
+// Reductions use chunks of a fixed size, and combine the chunk results in a fixed tree on the calling thread, so the
+// result doesn't depend on the number of threads or on how the chunks were scheduled.
+
+inline namespace WRAPPERSIMD_TARGET
+{
+namespace simd
+{
+	// Runs loops of independent tasks on a set of worker threads and the calling thread. Each participant is handed
+	// an equal range of task indices and works through it from the front. Participants which run out steal the back
+	// half of the range of another one, so uneven tasks still balance.
+	// One loop runs at a time; a loop started from inside a task runs on the calling thread alone. Tasks must not throw.
+	class ThreadPool
+	{
+	public:
+		// 'numThreads' counts the calling thread, so it starts 'numThreads - 1' workers
+		explicit ThreadPool(size_t numThreads = std::max(std::thread::hardware_concurrency(), 1u))
+		{
+			ranges = std::make_unique<Range[]>(std::max(numThreads, size_t{ 1 }));
+			for (size_t i = 1; i < numThreads; i++)
+				workers.emplace_back([this, i] { WorkerLoop(i); });
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard lock(mutex);
+				stopping = true;
+			}
+			wake.notify_all();
+			for (std::thread& worker : workers)
+				worker.join();
+		}
+
+		// Shared pool with one thread per hardware thread
+		static ThreadPool& Global()
+		{
+			static ThreadPool pool;
+			return pool;
+		}
+
+		size_t NumThreads() const
+		{
+			return workers.size() + 1;
+		}
+
+		// Calls 'func(i)' for every 'i' in [0, count), returning once all calls have finished
+		template <typename Func>
+		void ParallelFor(size_t count, Func&& func)
+		{
+			if (count == 0) return;
+			if (count == 1 || workers.empty() || insideTask)
+			{
+				for (size_t i = 0; i < count; i++)
+					func(i);
+				return;
+			}
+
+			std::lock_guard loopLock(loopMutex);
+			Job job;
+			job.invoke = [](void* context, size_t i) { (*static_cast<std::remove_reference_t<Func>*>(context))(i); };
+			job.context = &func;
+			job.count = count;
+
+			size_t participants = NumThreads();
+			for (size_t p = 0; p < participants; p++)
+			{
+				ranges[p].begin = count * p / participants;
+				ranges[p].end = count * (p + 1) / participants;
+			}
+
+			{
+				std::lock_guard lock(mutex);
+				current = &job;
+				generation++;
+			}
+			wake.notify_all();
+
+			Participate(job, 0);
+
+			// Wait for the other participants to finish their last tasks and stop touching 'job'
+			std::unique_lock lock(mutex);
+			finished.wait(lock, [&] { return job.done.load(std::memory_order_acquire) == count; });
+			current = nullptr;
+			finished.wait(lock, [&] { return active == 0; });
+		}
+
+	protected:
+		struct Job
+		{
+			void (*invoke)(void*, size_t);
+			void* context;
+			size_t count;
+			std::atomic<size_t> done = 0;
+		};
+
+		// Task indices still to run by one participant. Padded to a cache line, as each is locked by its owner for
+		// every task
+		struct alignas(64) Range
+		{
+			std::mutex mutex;
+			size_t begin = 0;
+			size_t end = 0;
+		};
+
+		void WorkerLoop(size_t participant)
+		{
+			insideTask = true;
+			uint64_t seen = 0;
+			while (true)
+			{
+				Job* job;
+				{
+					std::unique_lock lock(mutex);
+					wake.wait(lock, [&] { return stopping || (current && generation != seen); });
+					if (stopping) return;
+					seen = generation;
+					job = current;
+					active++;
+				}
+
+				Participate(*job, participant);
+
+				{
+					std::lock_guard lock(mutex);
+					active--;
+				}
+				finished.notify_all();
+			}
+		}
+
+		void Participate(Job& job, size_t participant)
+		{
+			bool wasInside = std::exchange(insideTask, true);
+			size_t idx;
+			while (TakeOwn(participant, idx) || Steal(participant, idx))
+			{
+				job.invoke(job.context, idx);
+				if (job.done.fetch_add(1, std::memory_order_acq_rel) + 1 == job.count)
+				{
+					// Lock so the notification can't fall between the caller's check and its wait
+					std::lock_guard lock(mutex);
+					finished.notify_all();
+				}
+			}
+			insideTask = wasInside;
+		}
+
+		bool TakeOwn(size_t participant, size_t& idx)
+		{
+			Range& range = ranges[participant];
+			std::lock_guard lock(range.mutex);
+			if (range.begin == range.end) return false;
+			idx = range.begin++;
+			return true;
+		}
+
+		// Moves the back half of the next range with tasks left to this participant's range, and takes its first task
+		bool Steal(size_t participant, size_t& idx)
+		{
+			size_t participants = NumThreads();
+			for (size_t offset = 1; offset < participants; offset++)
+			{
+				Range& victim = ranges[(participant + offset) % participants];
+				size_t begin, end;
+				{
+					std::lock_guard lock(victim.mutex);
+					size_t remaining = victim.end - victim.begin;
+					if (remaining == 0) continue;
+					end = victim.end;
+					begin = end - (remaining + 1) / 2;
+					victim.end = begin;
+				}
+
+				idx = begin;
+				Range& own = ranges[participant];
+				std::lock_guard lock(own.mutex);
+				own.begin = begin + 1;
+				own.end = end;
+				return true;
+			}
+			return false;
+		}
+
+		std::vector<std::thread> workers;
+		std::unique_ptr<Range[]> ranges;
+
+		std::mutex loopMutex;		// Held for the duration of a loop
+		std::mutex mutex;			// Guards the fields below
+		std::condition_variable wake;
+		std::condition_variable finished;
+		Job* current = nullptr;
+		uint64_t generation = 0;
+		size_t active = 0;
+		bool stopping = false;
+
+		static inline thread_local bool insideTask = false;
+	};
+
+	namespace detail
+	{
+		// Bytes per chunk: small enough for a chunk of input and output to stay in L2, large enough that scheduling
+		// costs are negligible. A multiple of every pack and cache line size
+		inline constexpr size_t ChunkBytes = size_t{ 64 } << 10;
+
+		// Chunk 'k' of 'size' elements is [Begin(k), Begin(k + 1)). The first chunk is 'head' elements longer than the
+		// others, 'head' aligning 'dst + Begin(k)' to a cache line for every later chunk
+		template <typename T>
+		class Chunking
+		{
+		public:
+			static constexpr size_t ChunkSize = ChunkBytes / sizeof(T);
+
+			Chunking(size_t size_, const T* dst)
+				: size(size_)
+			{
+				uintptr_t addr = reinterpret_cast<uintptr_t>(dst);
+				head = addr % sizeof(T) ? 0 : (64 - addr % 64) % 64 / sizeof(T);
+			}
+
+			size_t NumChunks() const
+			{
+				if (size == 0) return 0;
+				if (size <= head + ChunkSize) return 1;
+				return 1 + (size - head - 1) / ChunkSize;
+			}
+
+			size_t Begin(size_t k) const
+			{
+				return k == 0 ? 0 : std::min(size, head + k * ChunkSize);
+			}
+
+		protected:
+			size_t size;
+			size_t head;
+		};
+
+		// Folds two scalars with an 'op' that accepts packs
+		template <typename T, size_t PackSize, typename Op>
+		inline T FoldScalars(T a, T b, Op& op)
+		{
+			using Pack = ValuePack<T, PackSize>;
+			return op(Pack(a), Pack(b))[0];
+		}
+	}
+
+	// simd::transform split across the threads of 'pool'
+	template <typename T, typename Fn, size_t PackSize = NativeBytes / sizeof(T)>
+	inline void parallel_transform(std::span<const T> in, std::span<T> out, Fn fn, ThreadPool& pool = ThreadPool::Global())
+	{
+		assert(out.size() >= in.size());
+		detail::Chunking<T> chunks(in.size(), out.data());
+		pool.ParallelFor(chunks.NumChunks(), [&](size_t k)
+		{
+			size_t begin = chunks.Begin(k), end = chunks.Begin(k + 1);
+			transform<T, Fn, PackSize>(in.subspan(begin, end - begin), out.subspan(begin, end - begin), fn);
+		});
+	}
+
+	// Element-wise 'out[i] = fn(in1[i], in2[i])', split across the threads of 'pool'
+	template <typename T, typename Fn, size_t PackSize = NativeBytes / sizeof(T)>
+	inline void parallel_transform(std::span<const T> in1, std::span<const T> in2, std::span<T> out, Fn fn, ThreadPool& pool = ThreadPool::Global())
+	{
+		assert(in2.size() >= in1.size() && out.size() >= in1.size());
+		detail::Chunking<T> chunks(in1.size(), out.data());
+		pool.ParallelFor(chunks.NumChunks(), [&](size_t k)
+		{
+			size_t begin = chunks.Begin(k), end = chunks.Begin(k + 1);
+			transform<T, Fn, PackSize>(in1.subspan(begin, end - begin), in2.subspan(begin, end - begin), out.subspan(begin, end - begin), fn);
+		});
+	}
+
+	// simd::reduce split across the threads of 'pool', with the same requirements on 'op' and 'identity'.
+	// Chunks always start at multiples of the chunk size and their results are combined pairwise in a fixed order,
+	// so the result is the same for any number of threads
+	template <typename T, typename Op, size_t PackSize = NativeBytes / sizeof(T)>
+	inline T parallel_reduce(std::span<const T> in, T identity, Op op, ThreadPool& pool = ThreadPool::Global())
+	{
+		constexpr size_t ChunkSize = detail::ChunkBytes / sizeof(T);
+		size_t numChunks = (in.size() + ChunkSize - 1) / ChunkSize;
+		if (numChunks <= 1) return reduce<T, Op, PackSize>(in, identity, op);
+
+		std::vector<T> partial(numChunks);
+		pool.ParallelFor(numChunks, [&](size_t k)
+		{
+			size_t begin = k * ChunkSize;
+			partial[k] = reduce<T, Op, PackSize>(in.subspan(begin, std::min(ChunkSize, in.size() - begin)), identity, op);
+		});
+
+		for (size_t stride = 1; stride < numChunks; stride *= 2)
+			for (size_t k = 0; k + stride < numChunks; k += 2 * stride)
+				partial[k] = detail::FoldScalars<T, PackSize>(partial[k], partial[k + stride], op);
+		return partial[0];
+	}
+}
+} // namespace WRAPPERSIMD_TARGET
@@ -1,18 +1,88 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <utility>
+#include <vector>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "Profiler.h"
+
+#ifndef TIMING
 #define TIMING 1
+#endif
 
+// TIME_SCOPE(name) records the time until the end of the enclosing scope under 'name' in the ProfileRegistry, without
+// printing anything. STOP_LOG(name) stops a TIMER, prints its total time and records the time since it was last started under 'name'.
+// Built with TIMING defined to 0 they compile to nothing
 #if TIMING
 #define TIMER(name) Timer name
-#define STOP_LOG(name) { name.Stop(false); std::cout << #name << " took: "; name.Log(); }
-#define TIME_SCOPE(name) ScopedTimer name(#name)
+#define STOP_LOG(name) { static const ProfileScopeId name##ScopeId = ProfileRegistry::Instance().Register(#name); name.Stop(false); ProfileRegistry::Record(name##ScopeId, name.GetLastCycles()); std::cout << #name << " took: "; name.Log(); }
+#define TIME_SCOPE(name) ProfiledScope name([] { return std::string_view(#name); })
 #else
 #define TIMER(name)
 #define STOP_LOG(name)
 #define TIME_SCOPE(name)
 #endif
 
+// Reads of the time stamp counter which are ordered with the code they measure. A plain rdtsc can execute before
+// earlier instructions have finished, or after later ones have started.
+// Counts are TSC reference cycles, which tick at the nominal frequency rather than the current one, and include
+// 'Overhead()' cycles of the reads themselves
+class CycleCounter
+{
+public:
+	// Waits for earlier instructions to finish before reading, and keeps later ones from starting before it
+	static uint64_t Begin()
+	{
+		_mm_lfence();
+		uint64_t tsc = __rdtsc();
+		_mm_lfence();
+		return tsc;
+	}
+
+	// rdtscp waits for earlier instructions, the fence keeps later ones from starting before it
+	static uint64_t End()
+	{
+		unsigned int aux;
+		uint64_t tsc = __rdtscp(&aux);
+		_mm_lfence();
+		return tsc;
+	}
+
+	// Cycles counted between Begin() and End() with nothing in between, the least of many tries
+	static uint64_t Overhead()
+	{
+		static const uint64_t overhead = []
+		{
+			uint64_t least = UINT64_MAX;
+			for (int i = 0; i < 1000; i++)
+			{
+				uint64_t begin = Begin();
+				least = std::min(least, End() - begin);
+			}
+			return least;
+		}();
+		return overhead;
+	}
+};
+
 class Timer
 {
 	using Clock = std::chrono::steady_clock;
@@ -21,7 +91,7 @@ class Timer
 
 public:
 	Timer(bool start = true)
-		: duration(0)
+		: duration(0), cycles(0), lastCycles(0)
 	{
 		if (start) Start();
 	}
@@ -29,11 +99,15 @@ public:
 	void Start()
 	{
 		start = Clock::now();
+		startCycles = CycleCounter::Begin();
 	}
 	void Stop(bool log = true)
 	{
+		uint64_t endCycles = CycleCounter::End();
 		TimePoint end = Clock::now();
 		duration += (end - start);
+		lastCycles = endCycles - startCycles;
+		cycles += lastCycles;
 
 		if (log) Log();
 	}
@@ -46,14 +120,21 @@ public:
 		uint64_t count = duration.count();
 		double millis = (double)count / num * 1000.0;
 
-		if (millis < 1.0) std::cout << millis * 1000 << "us\n";
-		else std::cout << millis << "ms\n";
+		if (millis < 1.0) std::cout << millis * 1000 << "us";
+		else std::cout << millis << "ms";
+		std::cout << " (" << cycles << " cycles)\n";
 	}
 	Duration GetDuration() { return duration; }
+	uint64_t GetCycles() { return cycles; }
+	// Cycles between the last Start() and Stop()
+	uint64_t GetLastCycles() { return lastCycles; }
 
 protected:
 	TimePoint start;
 	Duration duration;
+	uint64_t startCycles;
+	uint64_t cycles;
+	uint64_t lastCycles;
 };
 
 class ScopedTimer : Timer
@@ -64,4 +145,216 @@ public:
 
 protected:
 	const char* name;
-};
\ No newline at end of file
+};
+
+// Hardware event counts, or nothing for events the counters couldn't count
+struct PerfCounts
+{
+	std::optional<double> cycles;
+	std::optional<double> instructions;
+	std::optional<double> l1dMisses;
+	std::optional<double> llcMisses;
+	std::optional<double> branchMisses;
+
+	// Instructions per (core) cycle
+	std::optional<double> IPC() const
+	{
+		if (!cycles || !instructions || *cycles == 0) return std::nullopt;
+		return *instructions / *cycles;
+	}
+};
+
+// Hardware performance counters of the calling thread, in user space, read with perf_event_open.
+// Events the CPU, kernel or perf_event_paranoid setting don't allow are left out; without any, or on other systems
+// than Linux, Available() is false and the counts are empty.
+// Counts are scaled up when the kernel had to share the counters with other events for part of the time
+class PerfCounters
+{
+public:
+	enum Event { Cycles, Instructions, L1DMisses, LLCMisses, BranchMisses, NumEvents };
+
+#ifdef __linux__
+	PerfCounters()
+	{
+		fds.fill(-1);
+		static constexpr uint64_t l1dReadMiss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		static constexpr std::array<std::pair<uint32_t, uint64_t>, NumEvents> events = { {
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ PERF_TYPE_HW_CACHE, l1dReadMiss },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		} };
+
+		// The first event to open leads the group, so all events are counted over the same time
+		for (size_t e = 0; e < NumEvents; e++)
+		{
+			perf_event_attr attr{};
+			attr.size = sizeof(attr);
+			attr.type = events[e].first;
+			attr.config = events[e].second;
+			attr.disabled = leader < 0;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+			if (fd < 0) continue;
+			if (leader < 0) leader = fd;
+			fds[e] = fd;
+		}
+	}
+
+	~PerfCounters()
+	{
+		for (int fd : fds)
+			if (fd >= 0) close(fd);
+	}
+
+	bool Available() const { return leader >= 0; }
+
+	// Zeroes the counts and starts counting
+	void Start()
+	{
+		if (leader < 0) return;
+		ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+
+	void Stop()
+	{
+		if (leader < 0) return;
+		ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	}
+
+	PerfCounts Read() const
+	{
+		PerfCounts counts;
+		if (leader < 0) return counts;
+
+		// Number of events, time enabled, time running, then one value per open event in the order they were opened
+		std::array<uint64_t, 3 + NumEvents> buffer{};
+		if (read(leader, buffer.data(), sizeof(buffer)) < static_cast<ssize_t>(3 * sizeof(uint64_t))) return counts;
+		double scale = buffer[2] > 0 ? static_cast<double>(buffer[1]) / static_cast<double>(buffer[2]) : 0.0;
+
+		std::array<std::optional<double>*, NumEvents> fields = { &counts.cycles, &counts.instructions, &counts.l1dMisses, &counts.llcMisses, &counts.branchMisses };
+		size_t value = 0;
+		for (size_t e = 0; e < NumEvents; e++)
+			if (fds[e] >= 0 && value < buffer[0])
+				*fields[e] = static_cast<double>(buffer[3 + value++]) * scale;
+		return counts;
+	}
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+protected:
+	std::array<int, NumEvents> fds;
+	int leader = -1;
+#else
+	bool Available() const { return false; }
+	void Start() {}
+	void Stop() {}
+	PerfCounts Read() const { return {}; }
+#endif
+};
+
+// Summary of a set of measurements
+struct Statistics
+{
+	double min = 0.0;
+	double median = 0.0;
+	double p99 = 0.0;
+	double mean = 0.0;
+	double stddev = 0.0;
+
+	static Statistics Of(std::vector<double> samples)
+	{
+		Statistics stats;
+		if (samples.empty()) return stats;
+
+		std::sort(samples.begin(), samples.end());
+		size_t n = samples.size();
+		stats.min = samples.front();
+		stats.median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+		// Nearest rank: the smallest sample at least 99% of the samples are less or equal to
+		stats.p99 = samples[static_cast<size_t>(std::ceil(0.99 * n)) - 1];
+
+		double sum = 0.0;
+		for (double x : samples) sum += x;
+		stats.mean = sum / n;
+
+		double squares = 0.0;
+		for (double x : samples) squares += (x - stats.mean) * (x - stats.mean);
+		stats.stddev = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+		return stats;
+	}
+};
+
+struct RepeatResult
+{
+	size_t repetitions = 0;
+	Statistics cycles;			// TSC reference cycles, without the overhead of reading the counter
+	Statistics nanoseconds;
+	PerfCounts counts;			// Per repetition, empty without counters
+
+	void Log(const char* name) const
+	{
+		std::cout << name << ": median " << cycles.median << " cycles (" << nanoseconds.median << "ns), min " << cycles.min
+			<< ", p99 " << cycles.p99 << ", stddev " << cycles.stddev << " over " << repetitions << " repetitions\n";
+
+		if (!counts.cycles && !counts.instructions && !counts.l1dMisses && !counts.llcMisses && !counts.branchMisses) return;
+		if (counts.instructions) std::cout << "  instructions " << *counts.instructions;
+		if (std::optional<double> ipc = counts.IPC()) std::cout << "  IPC " << *ipc;
+		if (counts.l1dMisses) std::cout << "  L1D misses " << *counts.l1dMisses;
+		if (counts.llcMisses) std::cout << "  LLC misses " << *counts.llcMisses;
+		if (counts.branchMisses) std::cout << "  branch misses " << *counts.branchMisses;
+		std::cout << " per repetition\n";
+	}
+};
+
+// Times 'func()' 'repetitions' times, after 'warmup' untimed calls to fill caches and branch predictors.
+// With 'counters', hardware events are counted over all timed repetitions, and averaged. Their counts include the
+// timer reads between repetitions, which are small next to anything worth repeating
+//
+//	RepeatResult result = Repeat([&] { simd::transform(in, out, fn); }, 1000);
+//	result.Log("transform");
+template <typename Func>
+inline RepeatResult Repeat(Func&& func, size_t repetitions = 100, size_t warmup = 10, PerfCounters* counters = nullptr)
+{
+	using Clock = std::chrono::steady_clock;
+
+	for (size_t i = 0; i < warmup; i++)
+		func();
+
+	std::vector<double> cycles(repetitions), nanoseconds(repetitions);
+	uint64_t overhead = CycleCounter::Overhead();
+
+	if (counters) counters->Start();
+	for (size_t i = 0; i < repetitions; i++)
+	{
+		Clock::time_point start = Clock::now();
+		uint64_t begin = CycleCounter::Begin();
+		func();
+		uint64_t end = CycleCounter::End();
+		std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+
+		uint64_t counted = end - begin;
+		cycles[i] = static_cast<double>(counted > overhead ? counted - overhead : 0);
+		nanoseconds[i] = elapsed.count();
+	}
+	if (counters) counters->Stop();
+
+	RepeatResult result;
+	result.repetitions = repetitions;
+	result.cycles = Statistics::Of(std::move(cycles));
+	result.nanoseconds = Statistics::Of(std::move(nanoseconds));
+	if (counters && repetitions > 0)
+	{
+		result.counts = counters->Read();
+		std::array<std::optional<double>*, PerfCounters::NumEvents> fields = { &result.counts.cycles, &result.counts.instructions, &result.counts.l1dMisses, &result.counts.llcMisses, &result.counts.branchMisses };
+		for (std::optional<double>* count : fields)
+			if (*count) **count /= static_cast<double>(repetitions);
+	}
+	return result;
+}
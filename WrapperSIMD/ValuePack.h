@@ -1,11 +1,98 @@
 #pragma once
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <type_traits>
+#include <utility>
 #include <format>
 
 #include <immintrin.h>
 
+// AVX-512 enables 512 bit packs, and mask register backed BoolPacks for them
+#ifndef WRAPPERSIMD_AVX512
+#ifdef __AVX512F__
+#define WRAPPERSIMD_AVX512 1
+#else
+#define WRAPPERSIMD_AVX512 0
+#endif
+#endif
+
+// Without AVX, 128 bit floating point comparisons must use the fixed predicate SSE forms
+#ifdef __AVX__
+#define WRAPPERSIMD_VEX 1
+#else
+#define WRAPPERSIMD_VEX 0
+#endif
+
+// 128 bit gathers are only used when the translation unit targets AVX2
+#ifdef __AVX2__
+#define WRAPPERSIMD_AVX2 1
+#else
+#define WRAPPERSIMD_AVX2 0
+#endif
+
+// AVX512VL extends the AVX-512 instructions, and their mask registers, to 128 and 256 bit packs
+#ifdef __AVX512VL__
+#define WRAPPERSIMD_AVX512VL 1
+#else
+#define WRAPPERSIMD_AVX512VL 0
+#endif
+
+// 'vpermb' and 'vpermt2b', full cross-lane byte permutes, need AVX512-VBMI. Without it they are built from 'pshufb'
+#ifdef __AVX512VBMI__
+#define WRAPPERSIMD_AVX512VBMI 1
+#else
+#define WRAPPERSIMD_AVX512VBMI 0
+#endif
+
+// 64 bit integer multiplies are a single instruction with AVX512DQ, and emulated without it
+#ifdef __AVX512DQ__
+#define WRAPPERSIMD_AVX512DQ 1
+#else
+#define WRAPPERSIMD_AVX512DQ 0
+#endif
+
+// FMA3 arrived alongside AVX2. MSVC has no '__FMA__', but allows itself to emit FMA instructions under /arch:AVX2
+#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define WRAPPERSIMD_FMA 1
+#else
+#define WRAPPERSIMD_FMA 0
+#endif
+
+// Element access reinterprets the vector register, GCC and Clang must be told the access may alias it
+#if defined(__GNUC__)
+#define WRAPPERSIMD_MAY_ALIAS [[gnu::may_alias]]
+#else
+#define WRAPPERSIMD_MAY_ALIAS
+#endif
+
+// Everything is declared in an inline namespace named after the instruction set the translation unit targets.
+// Translation units built with different flags can then be linked together (see Dispatch.h) without their
+// differently compiled instantiations of the same template being merged.
+#if WRAPPERSIMD_AVX512
+#define WRAPPERSIMD_TARGET simd_avx512
+#elif defined(__AVX2__)
+#define WRAPPERSIMD_TARGET simd_avx2
+#else
+#define WRAPPERSIMD_TARGET simd_sse42
+#endif
+
+// SVML provides the transcendental intrinsics (_mm256_sin_ps etc.), but only ships with MSVC and the Intel compilers.
+// Everywhere else the in-house kernels in PackMath.h are used. Define WRAPPERSIMD_SVML as 0 to force them.
+#ifndef WRAPPERSIMD_SVML
+#if (defined(_MSC_VER) && !defined(__clang__)) || defined(__INTEL_LLVM_COMPILER)
+#define WRAPPERSIMD_SVML 1
+#else
+#define WRAPPERSIMD_SVML 0
+#endif
+#endif
+
+inline namespace WRAPPERSIMD_TARGET
+{
 enum ComparisonOperator
 {
 	EQUAL = 0x0,
@@ -45,8 +132,23 @@ if constexpr (std::is_same_v<type, float>)\
 if constexpr (std::is_same_v<type, double>)\
 	return _mm##bits##_##op##_pd(__VA_ARGS__);}
 
-#define RETURN_OP(is256, op, type, ...)\
-if constexpr (is256)\
+#define RETURN_OP(width, op, type, ...)\
+if constexpr (width == 512)\
+{\
+	RETURN_OP_WITH_SIZE(512, op, type, __VA_ARGS__);\
+}\
+else if constexpr (width == 256)\
+{\
+	RETURN_OP_WITH_SIZE(256, op, type, __VA_ARGS__);\
+}\
+else\
+{\
+	RETURN_OP_WITH_SIZE(, op, type, __VA_ARGS__);\
+}\
+
+// For operations which have no 512 bit form, or only a fixed-arity macro one
+#define RETURN_OP_128_256(width, op, type, ...)\
+if constexpr (width == 256)\
 {\
 	RETURN_OP_WITH_SIZE(256, op, type, __VA_ARGS__);\
 }\
@@ -55,10 +157,54 @@ else\
 	RETURN_OP_WITH_SIZE(, op, type, __VA_ARGS__);\
 }\
 
+// AVX-512 comparisons, which produce a mask register
+#define RETURN_MASK_OP(op, type, ...) {\
+if constexpr (std::is_same_v<type, int8_t>)\
+	return _mm512_##op##_epi8_mask(__VA_ARGS__);\
+if constexpr (std::is_same_v<type, uint8_t>)\
+	return _mm512_##op##_epu8_mask(__VA_ARGS__);\
+if constexpr (std::is_same_v<type, int16_t>)\
+	return _mm512_##op##_epi16_mask(__VA_ARGS__);\
+if constexpr (std::is_same_v<type, uint16_t>)\
+	return _mm512_##op##_epu16_mask(__VA_ARGS__);\
+if constexpr (std::is_same_v<type, int32_t>)\
+	return _mm512_##op##_epi32_mask(__VA_ARGS__);\
+if constexpr (std::is_same_v<type, uint32_t>)\
+	return _mm512_##op##_epu32_mask(__VA_ARGS__);\
+if constexpr (std::is_same_v<type, int64_t>)\
+	return _mm512_##op##_epi64_mask(__VA_ARGS__);\
+if constexpr (std::is_same_v<type, uint64_t>)\
+	return _mm512_##op##_epu64_mask(__VA_ARGS__);\
+if constexpr (std::is_same_v<type, float>)\
+	return _mm512_##op##_ps_mask(__VA_ARGS__);\
+if constexpr (std::is_same_v<type, double>)\
+	return _mm512_##op##_pd_mask(__VA_ARGS__);}
+
 #define ADD_OP_METHOD(op, mmOpName)\
 inline ValuePack operator op (ValuePack other) const\
 {\
-	RETURN_OP(is256, mmOpName, ValTy, pack, other.pack);\
+	RETURN_OP(bitWidth, mmOpName, ValTy, pack, other.pack);\
+}
+
+#define ADD_SIGNLESS_OP_METHOD(op, mmOpName)\
+inline ValuePack operator op (ValuePack other) const\
+{\
+	RETURN_OP(bitWidth, mmOpName, SignlessTy<ValTy>, pack, other.pack);\
+}
+
+// Lanes outside 'mask' keep this pack's value. AVX-512 has masked forms of the floating point operations,
+// everything else computes every lane and blends
+#define ADD_MASKED_METHOD(funcName, op, mmOpName)\
+inline ValuePack funcName (BoolPack<PackSize, sizeof(ValTy)> mask, ValuePack other) const\
+{\
+	if constexpr (is512 && std::is_floating_point_v<ValTy>)\
+	{\
+		RETURN_OP_WITH_SIZE(512, mask_##mmOpName, ValTy, pack, mask.d, pack, other.pack);\
+	}\
+	else\
+	{\
+		return select(mask, (*this) op other, *this);\
+	}\
 }
 
 #define ADD_IN_PLACE_METHOD(op)\
@@ -86,21 +232,27 @@ inline ValuePack operator op (ValuePack other) const\
 {\
 	if constexpr (std::is_integral_v<ValTy>)\
 	{\
-		if constexpr (is256)\
+		if constexpr (is512)\
+			return _mm512_##mmOpName##_si512(pack, other.pack);\
+		else if constexpr (is256)\
 			return _mm256_##mmOpName##_si256(pack, other.pack);\
 		else\
 			return _mm_##mmOpName##_si128(pack, other.pack);\
 	}\
 	if constexpr (std::is_same_v<ValTy, float>)\
 	{\
-		if constexpr (is256)\
+		if constexpr (is512)\
+			return _mm512_##mmOpName##_ps(pack, other.pack);\
+		else if constexpr (is256)\
 			return _mm256_##mmOpName##_ps(pack, other.pack);\
 		else\
 			return _mm_##mmOpName##_ps(pack, other.pack);\
 	}\
 	if constexpr (std::is_same_v<ValTy, double>)\
 	{\
-		if constexpr (is256)\
+		if constexpr (is512)\
+			return _mm512_##mmOpName##_pd(pack, other.pack);\
+		else if constexpr (is256)\
 			return _mm256_##mmOpName##_pd(pack, other.pack);\
 		else\
 			return _mm_##mmOpName##_pd(pack, other.pack);\
@@ -110,13 +262,25 @@ inline ValuePack operator op (ValuePack other) const\
 #define ADD_COMP_OP(op, mmOpName, opCode)\
 inline BoolPack<PackSize, sizeof(ValTy)> operator op (ValuePack other)\
 {\
-	if constexpr (std::is_integral_v<ValTy>)\
+	if constexpr (is512 && std::is_integral_v<ValTy>)\
+	{\
+		RETURN_MASK_OP(mmOpName, ValTy, pack, other.pack);\
+	}\
+	else if constexpr (is512)\
+	{\
+		RETURN_MASK_OP(cmp, ValTy, pack, other.pack, opCode);\
+	}\
+	else if constexpr (std::is_integral_v<ValTy>)\
+	{\
+		return IntCompare<opCode>(*this, other);\
+	}\
+	else if constexpr (bitWidth == 128 && !WRAPPERSIMD_VEX)\
 	{\
-		RETURN_OP(is256, mmOpName, ValTy, pack, other.pack);\
+		RETURN_OP(bitWidth, mmOpName, ValTy, pack, other.pack);\
 	}\
 	else\
 	{\
-		RETURN_OP(is256, cmp, ValTy, pack, other.pack, opCode);\
+		RETURN_OP(bitWidth, cmp, ValTy, pack, other.pack, opCode);\
 	}\
 }
 
@@ -126,11 +290,73 @@ inline BoolPack<PackSize, sizeof(ValTy)> operator op (ValTy x)\
 	return (*this) op RepVal(x);\
 }
 
+// Loads and stores only distinguish between float, double and integer packs
+#define MEM_OP_WITH_SIZE(bits, intSuffix, op, ptr, ...) {\
+if constexpr (std::is_same_v<ValTy, float>)\
+	return _mm##bits##_##op##_ps(ptr __VA_ARGS__);\
+else if constexpr (std::is_same_v<ValTy, double>)\
+	return _mm##bits##_##op##_pd(ptr __VA_ARGS__);\
+else\
+	return _mm##bits##_##op##_##intSuffix((PackTy*)(ptr) __VA_ARGS__);}
+
+#define RETURN_LOAD_OP(op, ptr)\
+if constexpr (bitWidth == 512)\
+{\
+	MEM_OP_WITH_SIZE(512, si512, op, ptr);\
+}\
+else if constexpr (bitWidth == 256)\
+{\
+	MEM_OP_WITH_SIZE(256, si256, op, ptr);\
+}\
+else\
+{\
+	MEM_OP_WITH_SIZE(, si128, op, ptr);\
+}
+
+#define RETURN_STORE_OP(op, ptr)\
+if constexpr (bitWidth == 512)\
+{\
+	MEM_OP_WITH_SIZE(512, si512, op, ptr, , pack);\
+}\
+else if constexpr (bitWidth == 256)\
+{\
+	MEM_OP_WITH_SIZE(256, si256, op, ptr, , pack);\
+}\
+else\
+{\
+	MEM_OP_WITH_SIZE(, si128, op, ptr, , pack);\
+}
+
+// Gathers and scatters only exist for 32 and 64 bit elements
+#define GATHER_OP_WITH_SIZE(bits, op, ...) {\
+if constexpr (std::is_same_v<ValTy, float>)\
+	return _mm##bits##_##op##_ps(__VA_ARGS__);\
+else if constexpr (std::is_same_v<ValTy, double>)\
+	return _mm##bits##_##op##_pd(__VA_ARGS__);\
+else if constexpr (sizeof(ValTy) == 4)\
+	return _mm##bits##_##op##_epi32(__VA_ARGS__);\
+else\
+	return _mm##bits##_##op##_epi64(__VA_ARGS__);}
+
+#define RETURN_GATHER_OP(width, op, ...)\
+if constexpr (width == 512)\
+{\
+	GATHER_OP_WITH_SIZE(512, op, __VA_ARGS__);\
+}\
+else if constexpr (width == 256)\
+{\
+	GATHER_OP_WITH_SIZE(256, op, __VA_ARGS__);\
+}\
+else\
+{\
+	GATHER_OP_WITH_SIZE(, op, __VA_ARGS__);\
+}
+
 #define ADD_FREE_FUNC(funcName, mmOpName)\
 template <typename ValTy, size_t PackSize>\
 inline ValuePack<ValTy, PackSize> funcName (ValuePack<ValTy, PackSize> pack)\
 {\
-	RETURN_OP(pack.is256, mmOpName, ValTy, pack.pack);\
+	RETURN_OP(pack.bitWidth, mmOpName, ValTy, pack.pack);\
 }
 
 #define ADD_FREE_FRIEND(funcName)\
@@ -141,19 +367,58 @@ friend ValuePack<ValTy2, PackSize2> funcName (ValuePack<ValTy2, PackSize2> pack)
 template <typename ValTy, size_t PackSize>\
 inline ValuePack<ValTy, PackSize> funcName (ValuePack<ValTy, PackSize> pack1, ValuePack<ValTy, PackSize> pack2)\
 {\
-	RETURN_OP(pack1.is256, mmOpName, ValTy, pack1.pack, pack2.pack);\
+	RETURN_OP(pack1.bitWidth, mmOpName, ValTy, pack1.pack, pack2.pack);\
 }
 
 #define ADD_FREE_FRIEND_2ARG(funcName)\
 template <typename ValTy2, size_t PackSize2>\
 friend ValuePack<ValTy2, PackSize2> funcName (ValuePack<ValTy2, PackSize2> pack1, ValuePack<ValTy2, PackSize2> pack2);
 
+// 'fallback' is used for integers, and for floating point types without FMA3 (AVX-512 always includes it),
+// where it rounds twice
+#define ADD_FMA_FUNC(funcName, mmOpName, fallback)\
+template <typename ValTy, size_t PackSize>\
+inline ValuePack<ValTy, PackSize> funcName (ValuePack<ValTy, PackSize> a, ValuePack<ValTy, PackSize> b, ValuePack<ValTy, PackSize> c)\
+{\
+	if constexpr (std::is_floating_point_v<ValTy> && (WRAPPERSIMD_FMA || a.is512))\
+	{\
+		RETURN_OP(a.bitWidth, mmOpName, ValTy, a.pack, b.pack, c.pack);\
+	}\
+	else\
+	{\
+		return fallback;\
+	}\
+}
+
+#define ADD_FREE_FRIEND_3ARG(funcName)\
+template <typename ValTy2, size_t PackSize2>\
+friend ValuePack<ValTy2, PackSize2> funcName (ValuePack<ValTy2, PackSize2> a, ValuePack<ValTy2, PackSize2> b, ValuePack<ValTy2, PackSize2> c);
+
+#define ADD_ROUND_FUNC(funcName, mode)\
+template <typename ValTy, size_t PackSize>\
+inline ValuePack<ValTy, PackSize> funcName (ValuePack<ValTy, PackSize> pack)\
+{\
+	/* AVX-512 has no 'round', 'roundscale' with a scale of 0 takes the same immediate */\
+	if constexpr (pack.is512)\
+	{\
+		RETURN_OP_WITH_SIZE(512, roundscale, ValTy, pack.pack, mode | _MM_FROUND_NO_EXC);\
+	}\
+	else\
+	{\
+		RETURN_OP(pack.bitWidth, round, ValTy, pack.pack, mode | _MM_FROUND_NO_EXC);\
+	}\
+}
+
 template<typename ValTy, typename T>
 concept IsValTy = std::is_convertible_v<T, ValTy>;
 
 template <typename Arithmetic>
 using SumType = decltype(Arithmetic{} + Arithmetic{});
 
+// Integer operations which don't depend on signedness (add, sub, mullo, cmpeq...) only have 'epi' intrinsics
+template <typename ValTy>
+using SignlessTy = typename std::conditional_t<std::is_unsigned_v<ValTy>, std::make_signed<ValTy>, std::type_identity<ValTy>>::type;
+
 // Pre declare ValuePack
 template <typename ValTy, size_t PackSize>
 class ValuePack;
@@ -162,13 +427,19 @@ template <size_t NumElem, size_t ElemSize>
 class BoolPack
 {
 protected:
-	static_assert(NumElem * ElemSize == 16 || NumElem * ElemSize == 32, "Invalid BoolPack size");
+	static_assert(NumElem * ElemSize == 16 || NumElem * ElemSize == 32 || (WRAPPERSIMD_AVX512 && NumElem * ElemSize == 64), "Invalid BoolPack size");
 	static_assert(ElemSize == 1 || ElemSize == 2 || ElemSize == 4 || ElemSize == 8, "Invalid element size in BoolPack");
 	using ElemType =	std::conditional_t<ElemSize == 1, uint8_t,
 						std::conditional_t<ElemSize == 2, uint16_t,
 						std::conditional_t<ElemSize == 4, uint32_t, uint64_t>>>;
 
 	static constexpr bool is256 = (NumElem * ElemSize == 32);
+	static constexpr bool is512 = (NumElem * ElemSize == 64);
+
+	// 512 bit packs store one bit per element in a mask register
+	using MaskTy =	std::conditional_t<NumElem == 8, __mmask8,
+					std::conditional_t<NumElem == 16, __mmask16,
+					std::conditional_t<NumElem == 32, __mmask32, __mmask64>>>;
 
 public:
 	template<typename PackType>
@@ -177,7 +448,10 @@ public:
 
 	bool operator[](size_t idx) const
 	{
-		return (bool)d.vals[idx];
+		if constexpr (is512)
+			return (bool)((d >> idx) & 1);
+		else
+			return (bool)((const ElemRef*)&d)[idx];
 	}
 
 	inline operator bool() const
@@ -187,7 +461,11 @@ public:
 
 	inline bool All() const
 	{
-		if constexpr (is256)
+		if constexpr (is512)
+		{
+			return d == static_cast<MaskTy>(~MaskTy{ 0 });
+		}
+		else if constexpr (is256)
 		{
 			__m256i& pack = *(__m256i*) & d;
 			return (bool)_mm256_testc_si256((pack), _mm256_cmpeq_epi32((pack), (pack)));
@@ -201,7 +479,11 @@ public:
 
 	inline bool None() const
 	{
-		if constexpr (is256)
+		if constexpr (is512)
+		{
+			return d == 0;
+		}
+		else if constexpr (is256)
 		{
 			__m256i& pack = *(__m256i*) & d;
 			return (bool)_mm256_testz_si256(pack, pack);
@@ -213,17 +495,128 @@ public:
 		}
 	}
 
+	inline bool Any() const
+	{
+		return !None();
+	}
+
+	// One bit per element, element 0 in the lowest bit
+	inline uint64_t ToBits() const
+	{
+		if constexpr (is512)
+		{
+			return d;
+		}
+		else if constexpr (ElemSize == 4)
+		{
+			if constexpr (is256) return (uint32_t)_mm256_movemask_ps(Cast<float>().pack);
+			else return (uint32_t)_mm_movemask_ps(Cast<float>().pack);
+		}
+		else if constexpr (ElemSize == 8)
+		{
+			if constexpr (is256) return (uint32_t)_mm256_movemask_pd(Cast<double>().pack);
+			else return (uint32_t)_mm_movemask_pd(Cast<double>().pack);
+		}
+		else if constexpr (ElemSize == 2)
+		{
+			// Narrow each element to a byte first, saturation keeps 0 and -1 unchanged
+			__m128i bytes;
+			if constexpr (is256)
+			{
+				__m256i wide = Cast<int16_t>().pack;
+				bytes = _mm_packs_epi16(_mm256_castsi256_si128(wide), _mm256_extractf128_si256(wide, 1));
+			}
+			else
+			{
+				bytes = _mm_packs_epi16(Cast<int16_t>().pack, _mm_setzero_si128());
+			}
+			return (uint32_t)_mm_movemask_epi8(bytes);
+		}
+		else
+		{
+			if constexpr (is256) return (uint32_t)_mm256_movemask_epi8(Cast<int8_t>().pack);
+			else return (uint32_t)_mm_movemask_epi8(Cast<int8_t>().pack);
+		}
+	}
+
+	inline size_t Count() const
+	{
+		return std::popcount(ToBits());
+	}
+
+	// Index of the first set element, or NumElem if there is none
+	inline size_t FirstSet() const
+	{
+		if constexpr (NumElem < 64)
+			return std::countr_zero(ToBits() | (uint64_t{ 1 } << NumElem));
+		else
+			return std::countr_zero(ToBits());
+	}
+
+	// Index of the last set element, or NumElem if there is none
+	inline size_t LastSet() const
+	{
+		uint64_t bits = ToBits();
+		return bits ? 63 - std::countl_zero(bits) : NumElem;
+	}
+
+	// Iterates over the indices of the set elements, in increasing order
+	class SetLaneIterator
+	{
+	public:
+		SetLaneIterator(uint64_t bits_)
+			: bits(bits_) {}
+
+		size_t operator*() const { return std::countr_zero(bits); }
+		SetLaneIterator& operator++() { bits &= bits - 1; return *this; }
+		bool operator!=(SetLaneIterator other) const { return bits != other.bits; }
+
+	protected:
+		uint64_t bits;
+	};
+
+	struct SetLaneRange
+	{
+		uint64_t bits;
+
+		SetLaneIterator begin() const { return bits; }
+		SetLaneIterator end() const { return 0; }
+	};
+
+	// for (size_t idx : mask.SetLanes())
+	inline SetLaneRange SetLanes() const
+	{
+		return { ToBits() };
+	}
+
 	template <typename To>
 	inline ValuePack<To, NumElem* ElemSize / sizeof(To)> Cast() const
 	{
-		using PackTy = ValuePack<To, NumElem* ElemSize / sizeof(To)>::PackTy;
-		return std::bit_cast<PackTy>(d);
+		if constexpr (is512)
+		{
+			// Expand each mask bit to a full element
+			__m512i pack;
+			if constexpr (ElemSize == 1) pack = _mm512_maskz_set1_epi8(d, -1);
+			if constexpr (ElemSize == 2) pack = _mm512_maskz_set1_epi16(d, -1);
+			if constexpr (ElemSize == 4) pack = _mm512_maskz_set1_epi32(d, -1);
+			if constexpr (ElemSize == 8) pack = _mm512_maskz_set1_epi64(d, -1);
+			return ValuePack<ElemType, NumElem>(pack).template Cast<To>();
+		}
+		else
+		{
+			using PackTy = ValuePack<To, NumElem* ElemSize / sizeof(To)>::PackTy;
+			return std::bit_cast<PackTy>(d);
+		}
 	}
 
 	// Operators
 	inline BoolPack operator!() const
 	{
-		if constexpr (is256)
+		if constexpr (is512)
+		{
+			return static_cast<MaskTy>(~d);
+		}
+		else if constexpr (is256)
 		{
 			__m256i& pack = *(__m256i*) & d;
 			return _mm256_xor_si256(pack, _mm256_set1_epi64x(-1));
@@ -237,7 +630,11 @@ public:
 
 	inline BoolPack operator||(BoolPack other)
 	{
-		if constexpr (is256)
+		if constexpr (is512)
+		{
+			return static_cast<MaskTy>(d | other.d);
+		}
+		else if constexpr (is256)
 		{
 			__m256i& pack = *(__m256i*) & d;
 			__m256i& otherPack = *(__m256i*) & other.d;
@@ -253,7 +650,11 @@ public:
 
 	inline BoolPack operator&&(BoolPack other)
 	{
-		if constexpr (is256)
+		if constexpr (is512)
+		{
+			return static_cast<MaskTy>(d & other.d);
+		}
+		else if constexpr (is256)
 		{
 			__m256i& pack = *(__m256i*) & d;
 			__m256i& otherPack = *(__m256i*) & other.d;
@@ -268,14 +669,20 @@ public:
 	}
 
 protected:
-	struct Data
-	{
-		ElemType vals[NumElem];
-	};
+	// Held as a vector rather than an array of elements, which compilers split into scalar pieces on every conversion
+	using VectorData = std::conditional_t<is256, __m256i, __m128i>;
+	using Data = std::conditional_t<is512, MaskTy, VectorData>;
+	using ElemRef WRAPPERSIMD_MAY_ALIAS = ElemType;
 
-	alignas(NumElem* ElemSize) Data d;
-};
+	template <typename ValTy, size_t PackSize>
+	friend class ValuePack;
+
+	template <typename ValTy, size_t PackSize>
+	friend ValuePack<ValTy, PackSize> select(BoolPack<PackSize, sizeof(ValTy)> mask, ValuePack<ValTy, PackSize> a, ValuePack<ValTy, PackSize> b);
 
+	alignas(is512 ? sizeof(MaskTy) : NumElem * ElemSize) Data d;
+
+};
 template <typename ValTy, size_t PackSize>
 class ValuePack
 {
@@ -285,21 +692,30 @@ protected:
 		"Only integral, float, and double types are supported");
 
 	// Check if pack size is valid
+#if WRAPPERSIMD_AVX512
+	static_assert(sizeof(ValTy) * PackSize == 16 || sizeof(ValTy) * PackSize == 32 || sizeof(ValTy) * PackSize == 64, "Total pack size must be 128, 256 or 512 bits");
+#else
 	static_assert(sizeof(ValTy)* PackSize == 16 || sizeof(ValTy) * PackSize == 32, "Total pack size must be 128 or 256 bits");
+#endif
+
+	static constexpr size_t bitWidth = sizeof(ValTy) * PackSize * 8;
+	static constexpr bool is256 = (bitWidth == 256);
+	static constexpr bool is512 = (bitWidth == 512);
 
-	static constexpr bool is256 = (sizeof(ValTy) * PackSize == 32);
+	template <typename T128, typename T256, typename T512>
+	using BySize = std::conditional_t<bitWidth == 128, T128, std::conditional_t<bitWidth == 256, T256, T512>>;
 
 	using PackTy = std::conditional_t<std::is_integral_v<ValTy>,
 		// Integers
-		std::conditional_t<!is256, __m128i, __m256i>,
+		BySize<__m128i, __m256i, __m512i>,
 		
 		// Floating point
 		std::conditional_t<std::is_same_v<ValTy, float>,
 			// Float
-			std::conditional_t<PackSize == 4, __m128, __m256>,
+			BySize<__m128, __m256, __m512>,
 
 			// Double
-			std::conditional_t<PackSize == 2, __m128d, __m256d>>>;
+			BySize<__m128d, __m256d, __m512d>>>;
 public:
 
 	// == Constructors ==
@@ -327,54 +743,70 @@ public:
 	template <IsValTy<ValTy>... Vals>
 	static ValuePack Set(Vals... vals)
 	{
+		// There are no 'setr' intrinsics for most 512 bit types, load from memory instead
+		if constexpr (is512)
+		{
+			alignas(64) ValTy ordered[] = { vals... };
+			return Load(ordered);
+		}
+
 		// Large pack of int64_t or uint64_t, different 'set' function required
-		if constexpr (is256 && std::is_same_v<ValTy, int64_t>)
+		else if constexpr (is256 && std::is_same_v<ValTy, int64_t>)
 			return _mm256_setr_epi64x(vals...);
 		else if constexpr (is256 && std::is_same_v<ValTy, uint64_t>)
 			return _mm256_setr_epi64x(static_cast<int64_t>(vals)...);
 
-		// MSVC uses 'epi64x' even for 128 bit packs, despite the intel intrinsics docs
-		else if constexpr (!is256 && std::is_same_v<ValTy, int64_t>)
-			return _mm_setr_epi64x(vals...);
-		else if constexpr (!is256 && std::is_same_v<ValTy, uint64_t>)
-			return _mm_setr_epi64x(static_cast<int64_t>(vals)...);
+		// There is no portable '_mm_setr_epi64x', so reverse the two values manually
+		else if constexpr (bitWidth == 128 && (std::is_same_v<ValTy, int64_t> || std::is_same_v<ValTy, uint64_t>))
+		{
+			int64_t ordered[] = { static_cast<int64_t>(vals)... };
+			return _mm_set_epi64x(ordered[1], ordered[0]);
+		}
 
 		else if constexpr (std::is_unsigned_v<ValTy>)
 		{
 			// Type is unsigned, use the signed function with a cast
 			using OpTy = std::make_signed_t<ValTy>;
-			RETURN_OP(is256, setr, OpTy, static_cast<OpTy>(vals)...);
+			RETURN_OP_128_256(bitWidth, setr, OpTy, static_cast<OpTy>(vals)...);
 		}
 		else
 		{
-			RETURN_OP(is256, setr, ValTy, vals...);
+			RETURN_OP_128_256(bitWidth, setr, ValTy, vals...);
 		}
 	}
 
 	template <IsValTy<ValTy>... Vals>
 	static ValuePack SetReverse(Vals... vals)
 	{
+		if constexpr (is512)
+		{
+			alignas(64) ValTy ordered[PackSize];
+			size_t i = PackSize;
+			((ordered[--i] = vals), ...);
+			return Load(ordered);
+		}
+
 		// Large pack of int64_t or uint64_t, different 'set' function required
-		if constexpr (is256 && std::is_same_v<ValTy, int64_t>)
+		else if constexpr (is256 && std::is_same_v<ValTy, int64_t>)
 			return _mm256_set_epi64x(vals...);
 		else if constexpr (is256 && std::is_same_v<ValTy, uint64_t>)
 			return _mm256_set_epi64x(static_cast<int64_t>(vals)...);
 
 		// MSVC uses 'epi64x' even for 128 bit packs, despite the intel intrinsics docs
-		else if constexpr (!is256 && std::is_same_v<ValTy, int64_t>)
+		else if constexpr (bitWidth == 128 && std::is_same_v<ValTy, int64_t>)
 			return _mm_set_epi64x(vals...);
-		else if constexpr (!is256 && std::is_same_v<ValTy, uint64_t>)
+		else if constexpr (bitWidth == 128 && std::is_same_v<ValTy, uint64_t>)
 			return _mm_set_epi64x(static_cast<int64_t>(vals)...);
 
 		else if constexpr (std::is_unsigned_v<ValTy>)
 		{
 			// Type is unsigned, use the signed function with a cast
 			using OpTy = std::make_signed_t<ValTy>;
-			RETURN_OP(is256, set, OpTy, static_cast<OpTy>(vals)...);
+			RETURN_OP_128_256(bitWidth, set, OpTy, static_cast<OpTy>(vals)...);
 		}
 		else
 		{
-			RETURN_OP(is256, set, ValTy, vals...);
+			RETURN_OP_128_256(bitWidth, set, ValTy, vals...);
 		}
 	}
 
@@ -385,16 +817,20 @@ public:
 			return _mm256_set1_epi64x(x);
 		else if constexpr (is256 && std::is_same_v<ValTy, uint64_t>)
 			return _mm256_set1_epi64x(static_cast<int64_t>(x));
+		else if constexpr (bitWidth == 128 && std::is_same_v<ValTy, int64_t>)
+			return _mm_set1_epi64x(x);
+		else if constexpr (bitWidth == 128 && std::is_same_v<ValTy, uint64_t>)
+			return _mm_set1_epi64x(static_cast<int64_t>(x));
 
 		else if constexpr (std::is_unsigned_v<ValTy>)
 		{
 			// Type is unsigned, use the signed function with a cast
 			using OpTy = std::make_signed_t<ValTy>;
-			RETURN_OP(is256, set1, OpTy, static_cast<OpTy>(x));
+			RETURN_OP(bitWidth, set1, OpTy, static_cast<OpTy>(x));
 		}
 		else
 		{
-			RETURN_OP(is256, set1, ValTy, x);
+			RETURN_OP(bitWidth, set1, ValTy, x);
 		}
 	}
 
@@ -402,7 +838,7 @@ public:
 	{
 		if constexpr (std::is_floating_point_v<ValTy>)
 		{
-			return RepVal(first) + Range<0, 1>() * incr;
+			return fma(Range<ValTy(0), ValTy(1)>(), RepVal(incr), RepVal(first));
 		}
 		else
 			return RangeWithSet(first, incr);
@@ -414,70 +850,944 @@ public:
 		return RangeWithSet(first, incr);
 	}
 
-protected:
-	template <typename... Args>
-	static inline ValuePack DoRangeWithSet(ValTy incr, ValTy first, Args... others)
+	// == Memory ==
+	// 'ptr' must be aligned to the size of the pack
+	static ValuePack Load(const ValTy* ptr)
 	{
-		if constexpr (sizeof...(others) == PackSize - 1)
-			return SetReverse(first, others...);
-		else
-			return DoRangeWithSet(incr, first + incr, first, others...);
+#ifdef _DEBUG
+		assert(reinterpret_cast<uintptr_t>(ptr) % (bitWidth / 8) == 0);
+#endif
+		RETURN_LOAD_OP(load, ptr);
 	}
 
-	static ValuePack RangeWithSet(ValTy first, ValTy incr)
+	static ValuePack LoadUnaligned(const ValTy* ptr)
 	{
-		return DoRangeWithSet(incr, first);
+		RETURN_LOAD_OP(loadu, ptr);
 	}
 
-	template <size_t ShiftAmount, size_t... Sources>
-	static constexpr int32_t ToControlMask()
+	// Loads the first 'n' elements and zeroes the rest, without touching memory past 'ptr + n'
+	static ValuePack LoadPartial(const ValTy* ptr, size_t n)
 	{
-		int32_t ret = 0;
-		uint32_t i = 0;
-		for (size_t source : { Sources... })
+		if (n >= PackSize) return LoadUnaligned(ptr);
+
+		if constexpr (is512)
 		{
-			ret += source << (i * ShiftAmount);
-			i++;
+			auto mask = TailMask(n);
+			if constexpr (std::is_same_v<ValTy, float>)
+				return _mm512_maskz_loadu_ps(mask, ptr);
+			else if constexpr (std::is_same_v<ValTy, double>)
+				return _mm512_maskz_loadu_pd(mask, ptr);
+			else if constexpr (sizeof(ValTy) == 8)
+				return _mm512_maskz_loadu_epi64(mask, ptr);
+			else if constexpr (sizeof(ValTy) == 4)
+				return _mm512_maskz_loadu_epi32(mask, ptr);
+			else if constexpr (sizeof(ValTy) == 2)
+				return _mm512_maskz_loadu_epi16(mask, ptr);
+			else
+				return _mm512_maskz_loadu_epi8(mask, ptr);
 		}
-		return ret;
-	}
-
-	template <size_t ShiftAmount, size_t... Sources>
-	static constexpr int32_t HalfSizeControlMask()
-	{
-		int32_t ret = 0;
-		uint32_t i = 0;
-		for (size_t source : { Sources... })
+		else if constexpr (HasMaskMove())
 		{
-			source *= 2;
-			ret += source << (i * ShiftAmount);
-			i++;
-			ret += (source + 1) << (i * ShiftAmount);
-			i++;
+			auto mask = TailVector(n);
+			if constexpr (std::is_same_v<ValTy, float>)
+			{
+				RETURN_OP_128_256(bitWidth, maskload, float, ptr, mask);
+			}
+			else if constexpr (std::is_same_v<ValTy, double>)
+			{
+				RETURN_OP_128_256(bitWidth, maskload, double, ptr, mask);
+			}
+			else if constexpr (sizeof(ValTy) == 8)
+			{
+				RETURN_OP_128_256(bitWidth, maskload, int64_t, (const long long*)ptr, mask);
+			}
+			else
+			{
+				RETURN_OP_128_256(bitWidth, maskload, int32_t, (const int*)ptr, mask);
+			}
+		}
+		else
+		{
+			// No masked loads for 8 and 16 bit elements before AVX-512, for integers before AVX2, or for anything before AVX
+			alignas(bitWidth / 8) ValTy buffer[PackSize] = {};
+			std::memcpy(buffer, ptr, n * sizeof(ValTy));
+			return Load(buffer);
 		}
-		return ret;
 	}
 
-public:
-	// == Special members ==
-	static consteval size_t Size()
+	// 'ptr' must be aligned to the size of the pack
+	void Store(ValTy* ptr) const
 	{
-		return PackSize;
+#ifdef _DEBUG
+		assert(reinterpret_cast<uintptr_t>(ptr) % (bitWidth / 8) == 0);
+#endif
+		RETURN_STORE_OP(store, ptr);
 	}
 
-	// Array access operator
-	ValTy& operator[](size_t idx) const
+	void StoreUnaligned(ValTy* ptr) const
 	{
-#ifdef _DEBUG
-		assert(idx >= 0 && idx < PackSize);
-#endif
-		return ((ValTy*)&pack)[idx];
+		RETURN_STORE_OP(storeu, ptr);
+	}
+
+	// Stores the first 'n' elements, without touching memory past 'ptr + n'
+	void StorePartial(ValTy* ptr, size_t n) const
+	{
+		if (n >= PackSize) return StoreUnaligned(ptr);
+
+		if constexpr (is512)
+		{
+			auto mask = TailMask(n);
+			if constexpr (std::is_same_v<ValTy, float>)
+				_mm512_mask_storeu_ps(ptr, mask, pack);
+			else if constexpr (std::is_same_v<ValTy, double>)
+				_mm512_mask_storeu_pd(ptr, mask, pack);
+			else if constexpr (sizeof(ValTy) == 8)
+				_mm512_mask_storeu_epi64(ptr, mask, pack);
+			else if constexpr (sizeof(ValTy) == 4)
+				_mm512_mask_storeu_epi32(ptr, mask, pack);
+			else if constexpr (sizeof(ValTy) == 2)
+				_mm512_mask_storeu_epi16(ptr, mask, pack);
+			else
+				_mm512_mask_storeu_epi8(ptr, mask, pack);
+		}
+		else if constexpr (HasMaskMove())
+		{
+			auto mask = TailVector(n);
+			if constexpr (std::is_same_v<ValTy, float>)
+			{
+				RETURN_OP_128_256(bitWidth, maskstore, float, ptr, mask, pack);
+			}
+			else if constexpr (std::is_same_v<ValTy, double>)
+			{
+				RETURN_OP_128_256(bitWidth, maskstore, double, ptr, mask, pack);
+			}
+			else if constexpr (sizeof(ValTy) == 8)
+			{
+				RETURN_OP_128_256(bitWidth, maskstore, int64_t, (long long*)ptr, mask, pack);
+			}
+			else
+			{
+				RETURN_OP_128_256(bitWidth, maskstore, int32_t, (int*)ptr, mask, pack);
+			}
+		}
+		else
+		{
+			alignas(bitWidth / 8) ValTy buffer[PackSize];
+			Store(buffer);
+			std::memcpy(ptr, buffer, n * sizeof(ValTy));
+		}
+	}
+
+	// Non-temporal store which bypasses the cache, for output that won't be read again soon.
+	// 'ptr' must be aligned to the size of the pack. Call _mm_sfence() before another thread reads the data.
+	void StoreStream(ValTy* ptr) const
+	{
+#ifdef _DEBUG
+		assert(reinterpret_cast<uintptr_t>(ptr) % (bitWidth / 8) == 0);
+#endif
+		RETURN_STORE_OP(stream, ptr);
+	}
+
+	// Loads 'PackSize' structs of 'Fields' elements each, as one pack per field.
+	// For example xyz points: auto [x, y, z] = ValuePack<float, 8>::LoadInterleaved<3>(points)
+	template <size_t Fields>
+	static std::array<ValuePack, Fields> LoadInterleaved(const ValTy* ptr)
+	{
+		static_assert(Fields >= 2 && Fields <= 4, "LoadInterleaved supports 2, 3 or 4 fields");
+
+		std::array<ValuePack, Fields> packs;
+		for (size_t i = 0; i < Fields; i++)
+			packs[i] = LoadUnaligned(ptr + i * PackSize);
+
+		if constexpr (Fields == 2)
+		{
+			auto [first, second] = Unzip(packs[0], packs[1]);
+			return { first, second };
+		}
+		else if constexpr (Fields == 4)
+		{
+			// The even elements hold the first and third fields, the odd elements the second and fourth
+			auto [evens01, odds01] = Unzip(packs[0], packs[1]);
+			auto [evens23, odds23] = Unzip(packs[2], packs[3]);
+			auto [first, third] = Unzip(evens01, evens23);
+			auto [second, fourth] = Unzip(odds01, odds23);
+			return { first, second, third, fourth };
+		}
+		else
+		{
+			return [&]<size_t... Lanes>(std::index_sequence<Lanes...>) -> std::array<ValuePack, Fields>
+			{
+				return { SelectFrom<(3 * Lanes)...>(packs), SelectFrom<(3 * Lanes + 1)...>(packs), SelectFrom<(3 * Lanes + 2)...>(packs) };
+			}(std::make_index_sequence<PackSize>());
+		}
+	}
+
+	// Stores one pack per field as 'PackSize' structs, the inverse of LoadInterleaved
+	template <typename... Packs>
+	static void StoreInterleaved(ValTy* ptr, ValuePack first, Packs... others)
+	{
+		constexpr size_t Fields = sizeof...(Packs) + 1;
+		static_assert(Fields >= 2 && Fields <= 4, "StoreInterleaved supports 2, 3 or 4 fields");
+		static_assert((... && std::is_same_v<Packs, ValuePack>), "StoreInterleaved fields must all be the same type of pack");
+
+		std::array<ValuePack, Fields> fields{ first, others... };
+		std::array<ValuePack, Fields> packs;
+		if constexpr (Fields == 2)
+			packs = { fields[0].InterleaveLo(fields[1]), fields[0].InterleaveHi(fields[1]) };
+		else if constexpr (Fields == 4)
+		{
+			ValuePack evens01 = fields[0].InterleaveLo(fields[2]);
+			ValuePack evens23 = fields[0].InterleaveHi(fields[2]);
+			ValuePack odds01 = fields[1].InterleaveLo(fields[3]);
+			ValuePack odds23 = fields[1].InterleaveHi(fields[3]);
+			packs = { evens01.InterleaveLo(odds01), evens01.InterleaveHi(odds01), evens23.InterleaveLo(odds23), evens23.InterleaveHi(odds23) };
+		}
+		else
+		{
+			// Element j of the output comes from element j / 3 of field j % 3
+			packs = [&]<size_t... Lanes>(std::index_sequence<Lanes...>) -> std::array<ValuePack, Fields>
+			{
+				return {
+					SelectFrom<(((Lanes) % 3) * PackSize + (Lanes) / 3)...>(fields),
+					SelectFrom<(((Lanes + PackSize) % 3) * PackSize + (Lanes + PackSize) / 3)...>(fields),
+					SelectFrom<(((Lanes + 2 * PackSize) % 3) * PackSize + (Lanes + 2 * PackSize) / 3)...>(fields)
+				};
+			}(std::make_index_sequence<PackSize>());
+		}
+
+		for (size_t i = 0; i < Fields; i++)
+			packs[i].StoreUnaligned(ptr + i * PackSize);
+	}
+
+	// Loads 'base[indices[i]]' into each element. Indices are 32 or 64 bit integers, and are
+	// element offsets rather than byte offsets
+	template <typename IdxTy>
+	static ValuePack Gather(const ValTy* base, ValuePack<IdxTy, PackSize> indices)
+	{
+		static_assert(std::is_integral_v<IdxTy> && sizeof(IdxTy) >= 4, "Gather indices must be 32 or 64 bit integers");
+		constexpr size_t width = GatherWidth<IdxTy>();
+		constexpr int scale = sizeof(ValTy);
+
+		if constexpr (!HasGather<IdxTy>())
+		{
+			ValuePack ret;
+			for (size_t i = 0; i < PackSize; i++)
+				ret[i] = base[indices[i]];
+			return ret;
+		}
+		else if constexpr (width == 512)
+		{
+			// AVX-512 takes the indices first
+			if constexpr (sizeof(IdxTy) == 4)
+			{
+				GATHER_OP_WITH_SIZE(512, i32gather, indices.pack, base, scale);
+			}
+			else
+			{
+				GATHER_OP_WITH_SIZE(512, i64gather, indices.pack, base, scale);
+			}
+		}
+		else if constexpr (sizeof(IdxTy) == 4)
+		{
+			RETURN_GATHER_OP(width, i32gather, GatherPtr(base), indices.pack, scale);
+		}
+		else
+		{
+			RETURN_GATHER_OP(width, i64gather, GatherPtr(base), indices.pack, scale);
+		}
+	}
+
+	// As above, but only elements in 'mask' are loaded, the rest are taken from 'src'
+	template <typename IdxTy>
+	static ValuePack Gather(const ValTy* base, ValuePack<IdxTy, PackSize> indices, BoolPack<PackSize, sizeof(ValTy)> mask, ValuePack src = ValTy{})
+	{
+		static_assert(std::is_integral_v<IdxTy> && sizeof(IdxTy) >= 4, "Gather indices must be 32 or 64 bit integers");
+		constexpr size_t width = GatherWidth<IdxTy>();
+		constexpr int scale = sizeof(ValTy);
+
+		if constexpr (!HasGather<IdxTy>())
+		{
+			for (size_t i = 0; i < PackSize; i++)
+				if (mask[i]) src[i] = base[indices[i]];
+			return src;
+		}
+		else if constexpr (width == 512)
+		{
+			auto k = MaskRegister(mask);
+			if constexpr (sizeof(IdxTy) == 4)
+			{
+				GATHER_OP_WITH_SIZE(512, mask_i32gather, src.pack, k, indices.pack, base, scale);
+			}
+			else
+			{
+				GATHER_OP_WITH_SIZE(512, mask_i64gather, src.pack, k, indices.pack, base, scale);
+			}
+		}
+		else
+		{
+			auto maskVec = mask.template Cast<ValTy>().pack;
+			if constexpr (sizeof(IdxTy) == 4)
+			{
+				RETURN_GATHER_OP(width, mask_i32gather, src.pack, GatherPtr(base), indices.pack, maskVec, scale);
+			}
+			else
+			{
+				RETURN_GATHER_OP(width, mask_i64gather, src.pack, GatherPtr(base), indices.pack, maskVec, scale);
+			}
+		}
+	}
+
+	// Stores each element to 'base[indices[i]]'. Where indices repeat, the highest element wins.
+	// Uses AVX-512 scatters when available, and scalar stores otherwise
+	template <typename IdxTy>
+	void Scatter(ValTy* base, ValuePack<IdxTy, PackSize> indices) const
+	{
+		static_assert(std::is_integral_v<IdxTy> && sizeof(IdxTy) >= 4, "Scatter indices must be 32 or 64 bit integers");
+		constexpr size_t width = GatherWidth<IdxTy>();
+		constexpr int scale = sizeof(ValTy);
+
+		if constexpr (!HasScatter<IdxTy>())
+		{
+			for (size_t i = 0; i < PackSize; i++)
+				base[indices[i]] = (*this)[i];
+		}
+		else if constexpr (sizeof(IdxTy) == 4)
+		{
+			RETURN_GATHER_OP(width, i32scatter, base, indices.pack, pack, scale);
+		}
+		else
+		{
+			RETURN_GATHER_OP(width, i64scatter, base, indices.pack, pack, scale);
+		}
+	}
+
+	template <typename IdxTy>
+	void Scatter(ValTy* base, ValuePack<IdxTy, PackSize> indices, BoolPack<PackSize, sizeof(ValTy)> mask) const
+	{
+		static_assert(std::is_integral_v<IdxTy> && sizeof(IdxTy) >= 4, "Scatter indices must be 32 or 64 bit integers");
+		constexpr size_t width = GatherWidth<IdxTy>();
+		constexpr int scale = sizeof(ValTy);
+
+		if constexpr (!HasScatter<IdxTy>())
+		{
+			for (size_t i = 0; i < PackSize; i++)
+				if (mask[i]) base[indices[i]] = (*this)[i];
+		}
+		else
+		{
+			auto k = MaskRegister(mask);
+			if constexpr (sizeof(IdxTy) == 4)
+			{
+				RETURN_GATHER_OP(width, mask_i32scatter, base, k, indices.pack, pack, scale);
+			}
+			else
+			{
+				RETURN_GATHER_OP(width, mask_i64scatter, base, k, indices.pack, pack, scale);
+			}
+		}
+	}
+
+protected:
+	template <typename... Args>
+	static inline ValuePack DoRangeWithSet(ValTy incr, ValTy first, Args... others)
+	{
+		if constexpr (sizeof...(others) == PackSize - 1)
+			return SetReverse(first, others...);
+		else
+			return DoRangeWithSet(incr, first + incr, first, others...);
+	}
+
+	static ValuePack RangeWithSet(ValTy first, ValTy incr)
+	{
+		return DoRangeWithSet(incr, first);
+	}
+
+	// Mask register selecting the first 'n' elements
+	static auto TailMask(size_t n)
+	{
+		using MaskTy = BoolPack<PackSize, sizeof(ValTy)>::MaskTy;
+		return static_cast<MaskTy>((uint64_t{ 1 } << n) - 1);
+	}
+
+	// Gathers are named after the wider of the data and the index packs
+	template <typename IdxTy>
+	static constexpr size_t GatherWidth()
+	{
+		return std::max(bitWidth, sizeof(IdxTy) * PackSize * 8);
+	}
+
+	template <typename IdxTy>
+	static constexpr bool HasGather()
+	{
+		if constexpr (sizeof(ValTy) < 4) return false;
+		if constexpr (GatherWidth<IdxTy>() == 512) return WRAPPERSIMD_AVX512;
+		return WRAPPERSIMD_AVX2;
+	}
+
+	// Scatters narrower than 512 bits are AVX512VL instructions
+	template <typename IdxTy>
+	static constexpr bool HasScatter()
+	{
+		if constexpr (sizeof(ValTy) < 4) return false;
+		if constexpr (GatherWidth<IdxTy>() == 512) return WRAPPERSIMD_AVX512;
+		return WRAPPERSIMD_AVX512VL;
+	}
+
+	// AVX2 gathers don't take const pointers to integers
+	static auto GatherPtr(const ValTy* ptr)
+	{
+		if constexpr (std::is_floating_point_v<ValTy>)
+			return ptr;
+		else if constexpr (sizeof(ValTy) == 4)
+			return reinterpret_cast<const int*>(ptr);
+		else
+			return reinterpret_cast<const long long*>(ptr);
+	}
+
+	// AVX-512 operations on packs narrower than 512 bits still take a mask register
+	static auto MaskRegister(BoolPack<PackSize, sizeof(ValTy)> mask)
+	{
+		if constexpr (is512)
+			return mask.d;
+		else
+			return static_cast<__mmask8>(mask.ToBits());
+	}
+
+	// 'maskload' and 'maskstore' move 32 and 64 bit elements, integers only with AVX2. Without AVX2, the integer
+	// compares building a 256 bit TailVector aren't available either
+	static constexpr bool HasMaskMove()
+	{
+		if constexpr (sizeof(ValTy) < 4) return false;
+		if constexpr (std::is_floating_point_v<ValTy> && bitWidth == 128) return WRAPPERSIMD_VEX;
+		return WRAPPERSIMD_AVX2;
+	}
+
+	// Vector with the sign bit set in the first 'n' elements, as 'maskload' and 'maskstore' expect
+	static auto TailVector(size_t n)
+	{
+		using IdxTy = std::conditional_t<sizeof(ValTy) == 8, int64_t, int32_t>;
+		ValuePack<IdxTy, PackSize> idx = ValuePack<IdxTy, PackSize>::template Range<0, 1>();
+		return (ValuePack<IdxTy, PackSize>(static_cast<IdxTy>(n)) > idx).template Cast<IdxTy>().pack;
+	}
+
+	template <size_t ShiftAmount, size_t... Sources>
+	static constexpr int32_t ToControlMask()
+	{
+		int32_t ret = 0;
+		uint32_t i = 0;
+		for (size_t source : { Sources... })
+		{
+			ret += source << (i * ShiftAmount);
+			i++;
+		}
+		return ret;
+	}
+
+	template <size_t ShiftAmount, size_t... Sources>
+	static constexpr int32_t HalfSizeControlMask()
+	{
+		int32_t ret = 0;
+		uint32_t i = 0;
+		for (size_t source : { Sources... })
+		{
+			source *= 2;
+			ret += source << (i * ShiftAmount);
+			i++;
+			ret += (source + 1) << (i * ShiftAmount);
+			i++;
+		}
+		return ret;
+	}
+
+	// 'pshufb' control moving every byte of each source element to its destination. 'pshufb' can't cross
+	// 128 bit lanes, so bytes whose source is in the other lane ('OtherLane') or in the same lane ('!OtherLane')
+	// are zeroed instead, for a second shuffle of the swapped lanes to fill in
+	template <bool OtherLane, size_t... Sources>
+	static ValuePack<int8_t, bitWidth / 8> ByteShuffleControl()
+	{
+		static constexpr std::array<int8_t, bitWidth / 8> control = []
+		{
+			constexpr size_t sources[] = { Sources... };
+			std::array<int8_t, bitWidth / 8> ret{};
+			for (size_t dest = 0; dest < bitWidth / 8; dest++)
+			{
+				size_t from = sources[dest / sizeof(ValTy)] * sizeof(ValTy) + dest % sizeof(ValTy);
+				bool crossesLane = (from / 16) != (dest / 16);
+				ret[dest] = (crossesLane == OtherLane) ? static_cast<int8_t>(from % 16) : static_cast<int8_t>(0x80);
+			}
+			return ret;
+		}();
+		return ValuePack<int8_t, bitWidth / 8>::LoadUnaligned(control.data());
+	}
+
+#if WRAPPERSIMD_AVX512
+	// Byte 'i' becomes byte 'indices[i] % 64' of 'bytes', without AVX512-VBMI. 'pshufb' stays within each 128 bit
+	// block, so shuffle the pack and copies with its blocks rotated by one, two and three, then keep each byte
+	// from the copy that has its source block in the destination block
+	static __m512i PermuteBytes(__m512i bytes, __m512i indices)
+	{
+		__m512i sourceBlock = _mm512_and_si512(_mm512_srli_epi16(indices, 4), _mm512_set1_epi8(3));
+		__m512i destBlock = _mm512_setr_epi64(0, 0, 0x0101'0101'0101'0101, 0x0101'0101'0101'0101,
+			0x0202'0202'0202'0202, 0x0202'0202'0202'0202, 0x0303'0303'0303'0303, 0x0303'0303'0303'0303);
+		__m512i blockIndices = _mm512_and_si512(indices, _mm512_set1_epi8(15));
+
+		__m512i ret = _mm512_shuffle_epi8(bytes, blockIndices);
+		__m512i rotated = _mm512_shuffle_i64x2(bytes, bytes, 0b00'11'10'01);
+		__m512i rotatedBlock = _mm512_and_si512(_mm512_add_epi8(destBlock, _mm512_set1_epi8(1)), _mm512_set1_epi8(3));
+		ret = _mm512_mask_blend_epi8(_mm512_cmpeq_epi8_mask(sourceBlock, rotatedBlock), ret, _mm512_shuffle_epi8(rotated, blockIndices));
+		rotated = _mm512_shuffle_i64x2(bytes, bytes, 0b01'00'11'10);
+		rotatedBlock = _mm512_xor_si512(destBlock, _mm512_set1_epi8(2));
+		ret = _mm512_mask_blend_epi8(_mm512_cmpeq_epi8_mask(sourceBlock, rotatedBlock), ret, _mm512_shuffle_epi8(rotated, blockIndices));
+		rotated = _mm512_shuffle_i64x2(bytes, bytes, 0b10'01'00'11);
+		rotatedBlock = _mm512_and_si512(_mm512_add_epi8(destBlock, _mm512_set1_epi8(3)), _mm512_set1_epi8(3));
+		return _mm512_mask_blend_epi8(_mm512_cmpeq_epi8_mask(sourceBlock, rotatedBlock), ret, _mm512_shuffle_epi8(rotated, blockIndices));
+	}
+#endif
+
+	// SSE and AVX only compare signed integers, and only for equality and 'greater than'
+	static BoolPack<PackSize, sizeof(ValTy)> IntGreater(ValuePack a, ValuePack b)
+	{
+		using OpTy = SignlessTy<ValTy>;
+		if constexpr (std::is_unsigned_v<ValTy>)
+		{
+			// Flipping the sign bit maps unsigned order onto signed order
+			ValuePack signBit = static_cast<ValTy>(std::numeric_limits<OpTy>::min());
+			a ^= signBit;
+			b ^= signBit;
+		}
+		RETURN_OP(bitWidth, cmpgt, OpTy, a.pack, b.pack);
+	}
+
+	template <ComparisonOperator op>
+	static BoolPack<PackSize, sizeof(ValTy)> IntCompare(ValuePack a, ValuePack b)
+	{
+		if constexpr (op == EQUAL)
+		{
+			RETURN_OP(bitWidth, cmpeq, SignlessTy<ValTy>, a.pack, b.pack);
+		}
+		else if constexpr (op == GREATER)
+			return IntGreater(a, b);
+		else if constexpr (op == LESS)
+			return IntGreater(b, a);
+		else if constexpr (op == GREATER_EQUAL)
+			return !IntGreater(b, a);
+		else
+			return !IntGreater(a, b);
+	}
+
+	// Full 64 bit products of the low 32 bits of each 64 bit element
+	static ValuePack<uint64_t, PackSize> MulLow32(ValuePack<uint64_t, PackSize> a, ValuePack<uint64_t, PackSize> b)
+	{
+		RETURN_OP(bitWidth, mul, uint32_t, a.pack, b.pack);
+	}
+
+	// All ones in negative elements of a signed 64 bit pack, for emulating arithmetic right shifts
+	ValuePack SignMask() const
+	{
+		RETURN_OP(bitWidth, cmpgt, int64_t, RepVal(0).pack, pack);
+	}
+
+	// Signed integer of the same size as the elements, for byte level operations on any pack
+	using LaneIntTy =	std::conditional_t<sizeof(ValTy) == 1, int8_t,
+						std::conditional_t<sizeof(ValTy) == 2, int16_t,
+						std::conditional_t<sizeof(ValTy) == 4, int32_t, int64_t>>>;
+
+	// Moves every element 'Bytes' towards the end of the pack, shifting in zeros
+	template <size_t Bytes>
+	ValuePack ShiftUp() const
+	{
+		using IntTy = LaneIntTy;
+		ValuePack self = *this;
+		auto ints = self.template Cast<IntTy>().pack;
+
+		if constexpr (bitWidth == 128)
+			ints = _mm_slli_si128(ints, Bytes);
+		else if constexpr (bitWidth == 256)
+		{
+			// 'pslldq' stays within 128 bit lanes, the bytes crossing over come from the lower lane moved up
+			__m256i lowMovedUp = _mm256_permute2x128_si256(ints, ints, 0x08);
+			if constexpr (Bytes < 16)
+				ints = _mm256_alignr_epi8(ints, lowMovedUp, 16 - Bytes);
+			else if constexpr (Bytes == 16)
+				ints = lowMovedUp;
+			else
+				ints = _mm256_slli_si256(lowMovedUp, Bytes - 16);
+		}
+		else
+		{
+			// 'valignd' shifts across the whole register, but only by whole 32 bit elements.
+			// The remaining bytes are shifted within each 128 bit lane, taking the bytes crossing over from 16 bytes further up
+			constexpr int dwords = Bytes / 4;
+			__m512i zero = _mm512_setzero_si512();
+			if constexpr (Bytes % 4 == 0)
+				ints = _mm512_alignr_epi32(ints, zero, 16 - dwords);
+			else
+			{
+				__m512i high = dwords == 0 ? ints : _mm512_alignr_epi32(ints, zero, (16 - dwords) & 15);
+				__m512i low = dwords + 4 >= 16 ? zero : _mm512_alignr_epi32(ints, zero, (12 - dwords) & 15);
+				ints = _mm512_alignr_epi8(high, low, 16 - Bytes % 4);
+			}
+		}
+		return ValuePack<IntTy, PackSize>(ints).template Cast<ValTy>();
+	}
+
+	// Moves every element 'Bytes' towards the start of the pack, shifting in zeros
+	template <size_t Bytes>
+	ValuePack ShiftDown() const
+	{
+		using IntTy = LaneIntTy;
+		ValuePack self = *this;
+		auto ints = self.template Cast<IntTy>().pack;
+
+		if constexpr (bitWidth == 128)
+			ints = _mm_srli_si128(ints, Bytes);
+		else if constexpr (bitWidth == 256)
+		{
+			__m256i highMovedDown = _mm256_permute2x128_si256(ints, ints, 0x81);
+			if constexpr (Bytes < 16)
+				ints = _mm256_alignr_epi8(highMovedDown, ints, Bytes);
+			else if constexpr (Bytes == 16)
+				ints = highMovedDown;
+			else
+				ints = _mm256_srli_si256(highMovedDown, Bytes - 16);
+		}
+		else
+		{
+			constexpr int dwords = Bytes / 4;
+			__m512i zero = _mm512_setzero_si512();
+			if constexpr (Bytes % 4 == 0)
+				ints = _mm512_alignr_epi32(zero, ints, dwords);
+			else
+			{
+				__m512i low = dwords == 0 ? ints : _mm512_alignr_epi32(zero, ints, dwords & 15);
+				__m512i high = dwords + 4 >= 16 ? zero : _mm512_alignr_epi32(zero, ints, (dwords + 4) & 15);
+				ints = _mm512_alignr_epi8(high, low, Bytes % 4);
+			}
+		}
+		return ValuePack<IntTy, PackSize>(ints).template Cast<ValTy>();
+	}
+
+	// == Compile-time shuffle patterns ==
+	// Sources of 'PackSize' and above refer to the second pack of a two source shuffle.
+
+	// For 32 bit elements, the 'shufps' / 'pshufd' immediate when every 128 bit lane is shuffled within itself with
+	// the same pattern, or -1. With 'TwoSources', the first two elements of each lane must come from this pack
+	// and the last two from the other
+	template <bool TwoSources, size_t... Sources>
+	static constexpr int LaneShuffleImmediate()
+	{
+		constexpr size_t sources[] = { Sources... };
+		int ret = 0;
+		for (size_t i = 0; i < PackSize; i++)
+		{
+			size_t lane = i / 4;
+			size_t pos = i % 4;
+			bool fromOther = sources[i] >= PackSize;
+			if (fromOther != (TwoSources && pos >= 2)) return -1;
+
+			size_t from = sources[i] % PackSize;
+			if (from / 4 != lane) return -1;
+
+			int select = static_cast<int>(from % 4);
+			if (lane == 0) ret |= select << (2 * pos);
+			else if (((ret >> (2 * pos)) & 3) != select) return -1;
+		}
+		return ret;
+	}
+
+	// For 32 bit elements of a 256 bit pack, the 'vpermq' immediate when they move in aligned pairs, or -1
+	template <size_t... Sources>
+	static constexpr int PairImmediate()
+	{
+		constexpr size_t sources[] = { Sources... };
+		int ret = 0;
+		for (size_t pair = 0; pair < PackSize / 2; pair++)
+		{
+			size_t first = sources[2 * pair];
+			if (first % 2 != 0 || sources[2 * pair + 1] != first + 1) return -1;
+			ret |= static_cast<int>(first / 2) << (2 * pair);
+		}
+		return ret;
+	}
+
+	// Whether any element's source is in a different 128 bit lane
+	template <size_t... Sources>
+	static constexpr bool CrossesLanes()
+	{
+		constexpr size_t sources[] = { Sources... };
+		constexpr size_t laneSize = 16 / sizeof(ValTy);
+		for (size_t i = 0; i < PackSize; i++)
+			if ((sources[i] % PackSize) / laneSize != i / laneSize) return true;
+		return false;
+	}
+
+	// Whether each 128 bit lane is the interleaved lower ('High' false) or upper halves of the same lane of both packs,
+	// as 'unpacklo' and 'unpackhi' produce
+	template <bool High, size_t... Sources>
+	static constexpr bool IsUnpackPattern()
+	{
+		constexpr size_t sources[] = { Sources... };
+		constexpr size_t laneSize = 16 / sizeof(ValTy);
+		for (size_t i = 0; i < PackSize; i++)
+		{
+			size_t pos = i % laneSize;
+			size_t expected = (i - pos) + pos / 2 + (High ? laneSize / 2 : 0) + (pos % 2 ? PackSize : 0);
+			if (sources[i] != expected) return false;
+		}
+		return true;
+	}
+
+	// For 256 bit packs, the 'vperm2f128' immediate when each half is a whole half of either pack, or -1
+	template <size_t... Sources>
+	static constexpr int HalfMoveImmediate()
+	{
+		constexpr size_t sources[] = { Sources... };
+		constexpr size_t half = PackSize / 2;
+		int ret = 0;
+		for (size_t h = 0; h < 2; h++)
+		{
+			size_t first = sources[h * half];
+			if (first % half != 0) return -1;
+			for (size_t i = 1; i < half; i++)
+				if (sources[h * half + i] != first + i) return -1;
+			ret |= static_cast<int>(first / half) << (4 * h);
+		}
+		return ret;
+	}
+
+	// 'unpacklo' / 'unpackhi', which interleave within each 128 bit lane
+	template <bool High>
+	ValuePack UnpackLanes(ValuePack other) const
+	{
+		if constexpr (High)
+		{
+			RETURN_OP(bitWidth, unpackhi, SignlessTy<ValTy>, pack, other.pack);
+		}
+		else
+		{
+			RETURN_OP(bitWidth, unpacklo, SignlessTy<ValTy>, pack, other.pack);
+		}
+	}
+
+	template <bool High>
+	ValuePack Interleave(ValuePack other) const
+	{
+		ValuePack low, high;
+		if constexpr (High || bitWidth > 128)
+			high = UnpackLanes<true>(other);
+		if constexpr (!High || bitWidth > 128)
+			low = UnpackLanes<false>(other);
+
+		// 'unpack' interleaves within each 128 bit lane, the lanes are then put back in order
+		if constexpr (bitWidth == 128)
+			return High ? high : low;
+		else if constexpr (bitWidth == 256)
+		{
+			constexpr int select = High ? 0x31 : 0x20;
+			if constexpr (std::is_same_v<ValTy, float>) return _mm256_permute2f128_ps(low.pack, high.pack, select);
+			else if constexpr (std::is_same_v<ValTy, double>) return _mm256_permute2f128_pd(low.pack, high.pack, select);
+			else return _mm256_permute2x128_si256(low.pack, high.pack, select);
+		}
+		else
+		{
+			constexpr int64_t first = High ? 4 : 0;
+			__m512i lanes = _mm512_setr_epi64(first, first + 1, first + 8, first + 9, first + 2, first + 3, first + 10, first + 11);
+			if constexpr (std::is_same_v<ValTy, float>)
+				return _mm512_castpd_ps(_mm512_permutex2var_pd(_mm512_castps_pd(low.pack), lanes, _mm512_castps_pd(high.pack)));
+			else if constexpr (std::is_same_v<ValTy, double>)
+				return _mm512_permutex2var_pd(low.pack, lanes, high.pack);
+			else
+				return _mm512_permutex2var_epi64(low.pack, lanes, high.pack);
+		}
+	}
+
+	// The even and odd elements of 'a' followed by 'b'
+	static std::pair<ValuePack, ValuePack> Unzip(ValuePack a, ValuePack b)
+	{
+		// Unzip within each 128 bit lane first, then put the 64 bit halves of the lanes back in order
+		using IntPack = ValuePack<LaneIntTy, PackSize>;
+		using Int64Pack = ValuePack<int64_t, bitWidth / 64>;
+		Int64Pack evens, odds;
+		if constexpr (sizeof(ValTy) == 8)
+		{
+			evens = a.template UnpackLanes<false>(b).template Cast<LaneIntTy>().pack;
+			odds = a.template UnpackLanes<true>(b).template Cast<LaneIntTy>().pack;
+		}
+		else if constexpr (sizeof(ValTy) == 4)
+		{
+			auto af = a.template Cast<float>().pack;
+			auto bf = b.template Cast<float>().pack;
+			ValuePack<float, PackSize> evenFloats, oddFloats;
+			if constexpr (bitWidth == 128) { evenFloats = _mm_shuffle_ps(af, bf, 0x88); oddFloats = _mm_shuffle_ps(af, bf, 0xDD); }
+			else if constexpr (bitWidth == 256) { evenFloats = _mm256_shuffle_ps(af, bf, 0x88); oddFloats = _mm256_shuffle_ps(af, bf, 0xDD); }
+			else { evenFloats = _mm512_shuffle_ps(af, bf, 0x88); oddFloats = _mm512_shuffle_ps(af, bf, 0xDD); }
+			evens = evenFloats.template Cast<LaneIntTy>().pack;
+			odds = oddFloats.template Cast<LaneIntTy>().pack;
+		}
+		else
+		{
+			// Gather the even elements of each lane into its low 64 bits, and the odd ones into its high 64 bits
+			constexpr size_t laneSize = 16 / sizeof(ValTy);
+			ValuePack<int8_t, bitWidth / 8> control;
+			for (size_t i = 0; i < bitWidth / 8; i++)
+			{
+				size_t elem = (i % 16) / sizeof(ValTy);
+				size_t from = elem < laneSize / 2 ? 2 * elem : 2 * (elem - laneSize / 2) + 1;
+				control[i] = static_cast<int8_t>(from * sizeof(ValTy) + i % sizeof(ValTy));
+			}
+			Int64Pack aInts = a.template Cast<LaneIntTy>().pack;
+			Int64Pack bInts = b.template Cast<LaneIntTy>().pack;
+			if constexpr (bitWidth == 128) { aInts = _mm_shuffle_epi8(aInts.pack, control.pack); bInts = _mm_shuffle_epi8(bInts.pack, control.pack); }
+			else if constexpr (bitWidth == 256) { aInts = _mm256_shuffle_epi8(aInts.pack, control.pack); bInts = _mm256_shuffle_epi8(bInts.pack, control.pack); }
+			else { aInts = _mm512_shuffle_epi8(aInts.pack, control.pack); bInts = _mm512_shuffle_epi8(bInts.pack, control.pack); }
+			evens = aInts.template UnpackLanes<false>(bInts);
+			odds = aInts.template UnpackLanes<true>(bInts);
+		}
+
+		if constexpr (bitWidth == 256)
+		{
+			evens = evens.template Permute<0, 2, 1, 3>();
+			odds = odds.template Permute<0, 2, 1, 3>();
+		}
+		else if constexpr (bitWidth == 512)
+		{
+			evens = evens.template Permute<0, 2, 4, 6, 1, 3, 5, 7>();
+			odds = odds.template Permute<0, 2, 4, 6, 1, 3, 5, 7>();
+		}
+		return { IntPack(evens.pack).template Cast<ValTy>(), IntPack(odds.pack).template Cast<ValTy>() };
+	}
+
+	// Element i of the result is element 'Sources[i]' of the packs laid end to end, which are three packs at most
+	template <size_t... Sources, size_t Count>
+	static ValuePack SelectFrom(const std::array<ValuePack, Count>& packs)
+	{
+		ValuePack firstTwo = packs[0].template Shuffle2<(Sources < 2 * PackSize ? Sources : Sources % PackSize)...>(packs[1]);
+		if constexpr (Count == 2)
+			return firstTwo;
+		else
+			return firstTwo.template Blend<(Sources >= 2 * PackSize)...>(packs[2].template Permute<(Sources % PackSize)...>());
+	}
+
+	// Row 'Row' of the matrix after swapping the off-diagonal halves of each 'Block' sized block
+	template <size_t Block, size_t Row>
+	static ValuePack SwapBlocksRow(const std::array<ValuePack, PackSize>& rows)
+	{
+		return [&]<size_t... Lanes>(std::index_sequence<Lanes...>)
+		{
+			if constexpr (Row & Block)
+				return rows[Row - Block].template Shuffle2<((Lanes & Block) ? Lanes + PackSize : Lanes + Block)...>(rows[Row]);
+			else
+				return rows[Row].template Shuffle2<((Lanes & Block) ? Lanes - Block + PackSize : Lanes)...>(rows[Row + Block]);
+		}(std::make_index_sequence<PackSize>());
+	}
+
+	// Transposes the matrix of 128 bit blocks, swapping the off-diagonal halves, then quarters... of the matrix
+	template <size_t Block>
+	static void TransposeBlocks(std::array<ValuePack, PackSize>& rows)
+	{
+		if constexpr (Block >= 16 / sizeof(ValTy))
+		{
+			rows = [&]<size_t... Rows>(std::index_sequence<Rows...>) -> std::array<ValuePack, PackSize>
+			{
+				return { SwapBlocksRow<Block, Rows>(rows)... };
+			}(std::make_index_sequence<PackSize>());
+			TransposeBlocks<Block / 2>(rows);
+		}
+	}
+
+	// Transposes within each 128 bit block. Interleaving the first half of the rows of a block with the second half,
+	// log2(block size) times, transposes it
+	template <size_t Rounds>
+	static void TransposeLanes(std::array<ValuePack, PackSize>& rows)
+	{
+		constexpr size_t laneSize = 16 / sizeof(ValTy);
+		if constexpr (Rounds > 0)
+		{
+			rows = [&]<size_t... Rows>(std::index_sequence<Rows...>) -> std::array<ValuePack, PackSize>
+			{
+				return { rows[Rows - Rows % laneSize + (Rows % laneSize) / 2].template UnpackLanes<(Rows % 2 == 1)>(
+					rows[Rows - Rows % laneSize + (Rows % laneSize) / 2 + laneSize / 2])... };
+			}(std::make_index_sequence<PackSize>());
+			TransposeLanes<Rounds - 1>(rows);
+		}
+	}
+
+	// 'ShiftUp' within each 128 bit lane of a 256 bit pack
+	template <size_t Bytes>
+	ValuePack ShiftUpInLanes() const
+	{
+		ValuePack self = *this;
+		return ValuePack<LaneIntTy, PackSize>(_mm256_slli_si256(self.template Cast<LaneIntTy>().pack, Bytes)).template Cast<ValTy>();
+	}
+
+	// The last element of each 128 bit lane of a 256 bit pack, repeated across the lane
+	ValuePack LaneLast() const
+	{
+		// Byte indices of the last element, repeated for each element
+		static constexpr uint64_t lastBytes = []
+		{
+			uint64_t element = 0;
+			for (size_t byte = 0; byte < sizeof(ValTy); byte++)
+				element |= uint64_t{ 16 - sizeof(ValTy) + byte } << (8 * byte);
+			uint64_t ret = 0;
+			for (size_t byte = 0; byte < 8; byte += sizeof(ValTy))
+				ret |= element << (8 * byte);
+			return ret;
+		}();
+
+		ValuePack self = *this;
+		__m256i control = _mm256_set1_epi64x(static_cast<int64_t>(lastBytes));
+		return ValuePack<LaneIntTy, PackSize>(_mm256_shuffle_epi8(self.template Cast<LaneIntTy>().pack, control)).template Cast<ValTy>();
+	}
+
+	// One compare-exchange stage of a bitonic network: lanes 'i' and 'i ^ Distance' are compared, and within
+	// each run of 'Block' lanes the smaller value goes to the lower lane, with the direction alternating between runs
+	template <size_t Block, size_t Distance>
+	ValuePack BitonicStage() const
+	{
+		return [this]<size_t... Lanes>(std::index_sequence<Lanes...>)
+		{
+			ValuePack partner = Permute<(Lanes ^ Distance)...>();
+			ValuePack lower = min(*this, partner);
+			ValuePack upper = max(*this, partner);
+			return lower.template Blend<(((Lanes & Distance) != 0) == ((Lanes & Block) == 0))...>(upper);
+		}(std::make_index_sequence<PackSize>());
+	}
+
+	// Runs the stages from 'Block', 'Distance' to the end of the network
+	template <size_t Block, size_t Distance>
+	ValuePack BitonicStages() const
+	{
+		ValuePack ret = BitonicStage<Block, Distance>();
+		if constexpr (Distance > 1)
+			return ret.template BitonicStages<Block, Distance / 2>();
+		else if constexpr (Block < PackSize)
+			return ret.template BitonicStages<Block * 2, Block>();
+		else
+			return ret;
+	}
+
+public:
+	// == Special members ==
+	static consteval size_t Size()
+	{
+		return PackSize;
+	}
+
+	// Array access operator
+	using ElemRef WRAPPERSIMD_MAY_ALIAS = ValTy;
+	ElemRef& operator[](size_t idx) const
+	{
+#ifdef _DEBUG
+		assert(idx >= 0 && idx < PackSize);
+#endif
+		return ((ElemRef*)&pack)[idx];
 	}
 
 	template<typename To>
 	inline ValuePack<To, PackSize> Convert()
 	{
-		static constexpr bool cvtIs256 = is256 || (sizeof(To) * PackSize == 32);
+		static constexpr size_t cvtBitWidth = std::max(bitWidth, sizeof(To) * PackSize * 8);
 
 		// Types are the same, no conversion necessary
 		if constexpr (std::is_same_v<ValTy, To>) return (*this);
@@ -487,25 +1797,25 @@ public:
 			if constexpr (std::is_same_v<std::make_unsigned_t<ValTy>, std::make_unsigned_t<To>>) return pack;
 
 		if constexpr (std::is_same_v<ValTy, int8_t>)
-			RETURN_OP(cvtIs256, cvtepi8, To, pack);
+			RETURN_OP(cvtBitWidth, cvtepi8, To, pack);
 		if constexpr (std::is_same_v<ValTy, uint8_t>)
-			RETURN_OP(cvtIs256, cvtepu8, To, pack);
+			RETURN_OP(cvtBitWidth, cvtepu8, To, pack);
 		if constexpr (std::is_same_v<ValTy, int16_t>)
-			RETURN_OP(cvtIs256, cvtepi16, To, pack);
+			RETURN_OP(cvtBitWidth, cvtepi16, To, pack);
 		if constexpr (std::is_same_v<ValTy, uint16_t>)
-			RETURN_OP(cvtIs256, cvtepu16, To, pack);
+			RETURN_OP(cvtBitWidth, cvtepu16, To, pack);
 		if constexpr (std::is_same_v<ValTy, int32_t>)
-			RETURN_OP(cvtIs256, cvtepi32, To, pack);
+			RETURN_OP(cvtBitWidth, cvtepi32, To, pack);
 		if constexpr (std::is_same_v<ValTy, uint32_t>)
-			RETURN_OP(cvtIs256, cvtepu32, To, pack);
+			RETURN_OP(cvtBitWidth, cvtepu32, To, pack);
 		if constexpr (std::is_same_v<ValTy, int64_t>)
-			RETURN_OP(cvtIs256, cvtepi64, To, pack);
+			RETURN_OP(cvtBitWidth, cvtepi64, To, pack);
 		if constexpr (std::is_same_v<ValTy, uint64_t>)
-			RETURN_OP(cvtIs256, cvtepu64, To, pack);
+			RETURN_OP(cvtBitWidth, cvtepu64, To, pack);
 		if constexpr (std::is_same_v<ValTy, float>)
-			RETURN_OP(cvtIs256, cvtps, To, pack);
+			RETURN_OP(cvtBitWidth, cvtps, To, pack);
 		if constexpr (std::is_same_v<ValTy, double>)
-			RETURN_OP(cvtIs256, cvtpd, To, pack);
+			RETURN_OP(cvtBitWidth, cvtpd, To, pack);
 	}
 
 	template<typename To>
@@ -519,17 +1829,17 @@ public:
 			return pack;
 
 		// 128 bit
-		if constexpr (!is256 && std::is_same_v<ValTy, float> && std::is_same_v<To, double>)
+		if constexpr (bitWidth == 128 && std::is_same_v<ValTy, float> && std::is_same_v<To, double>)
 			return _mm_castps_pd(pack);
-		if constexpr (!is256 && std::is_same_v<ValTy, float> && std::is_integral_v<To>)
+		if constexpr (bitWidth == 128 && std::is_same_v<ValTy, float> && std::is_integral_v<To>)
 			return _mm_castps_si128(pack);
-		if constexpr (!is256 && std::is_same_v<ValTy, double> && std::is_same_v<To, float>)
+		if constexpr (bitWidth == 128 && std::is_same_v<ValTy, double> && std::is_same_v<To, float>)
 			return _mm_castpd_ps(pack);
-		if constexpr (!is256 && std::is_same_v<ValTy, double> && std::is_integral_v<To>)
+		if constexpr (bitWidth == 128 && std::is_same_v<ValTy, double> && std::is_integral_v<To>)
 			return _mm_castpd_si128(pack);
-		if constexpr (!is256 && std::is_integral_v<ValTy> && std::is_same_v<To, float>)
+		if constexpr (bitWidth == 128 && std::is_integral_v<ValTy> && std::is_same_v<To, float>)
 			return _mm_castsi128_ps(pack);
-		if constexpr (!is256 && std::is_integral_v<ValTy> && std::is_same_v<To, double>)
+		if constexpr (bitWidth == 128 && std::is_integral_v<ValTy> && std::is_same_v<To, double>)
 			return _mm_castsi128_pd(pack);
 
 		// 256 bit
@@ -545,6 +1855,20 @@ public:
 			return _mm256_castsi256_ps(pack);
 		if constexpr (is256 && std::is_integral_v<ValTy> && std::is_same_v<To, double>)
 			return _mm256_castsi256_pd(pack);
+
+		// 512 bit
+		if constexpr (is512 && std::is_same_v<ValTy, float> && std::is_same_v<To, double>)
+			return _mm512_castps_pd(pack);
+		if constexpr (is512 && std::is_same_v<ValTy, float> && std::is_integral_v<To>)
+			return _mm512_castps_si512(pack);
+		if constexpr (is512 && std::is_same_v<ValTy, double> && std::is_same_v<To, float>)
+			return _mm512_castpd_ps(pack);
+		if constexpr (is512 && std::is_same_v<ValTy, double> && std::is_integral_v<To>)
+			return _mm512_castpd_si512(pack);
+		if constexpr (is512 && std::is_integral_v<ValTy> && std::is_same_v<To, float>)
+			return _mm512_castsi512_ps(pack);
+		if constexpr (is512 && std::is_integral_v<ValTy> && std::is_same_v<To, double>)
+			return _mm512_castsi512_pd(pack);
 	}
 
 	template <size_t... Sources>
@@ -554,12 +1878,13 @@ public:
 		static_assert((... && (Sources < PackSize)), "Permute sources out of range");
 
 		// 128 bit
-		if constexpr (!is256)
+		if constexpr (bitWidth == 128)
 		{
 			// int32 and uint32
 			if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) == 4)
 			{
-				return _mm_shuffle_epi32(pack, ToControlMask<2, Sources...>());
+				constexpr int32_t mask = ToControlMask<2, Sources...>();
+				return _mm_shuffle_epi32(pack, mask);
 			}
 
 			// int8 and uint8
@@ -571,13 +1896,19 @@ public:
 			// int64 and uint64
 			if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) == 8)
 			{
-				return _mm_shuffle_epi32(pack, HalfSizeControlMask<2, Sources...>());
+				constexpr int32_t mask = HalfSizeControlMask<2, Sources...>();
+				return _mm_shuffle_epi32(pack, mask);
 			}
 
 			// float
 			if constexpr (std::is_same_v<ValTy, float>)
 			{
-				return _mm_permute_ps(pack, ToControlMask<2, Sources...>());
+				// 'vpermilps' needs AVX, 'shufps' with both sources the same is equivalent
+				constexpr int32_t mask = ToControlMask<2, Sources...>();
+				if constexpr (WRAPPERSIMD_VEX)
+					return _mm_permute_ps(pack, mask);
+				else
+					return _mm_shuffle_ps(pack, pack, mask);
 			}
 
 			// double
@@ -587,40 +1918,490 @@ public:
 				//return _mm_permute_pd(pack, ToControlMask<1, Sources...>());
 
 				// Using _mm_shuffle_pd instead
-				return _mm_shuffle_pd(pack, pack, ToControlMask<1, Sources...>());
+				constexpr int32_t mask = ToControlMask<1, Sources...>();
+				return _mm_shuffle_pd(pack, pack, mask);
 			}
 
-			// TODO int16 and uint16
+			// int16 and uint16
+			if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) == 2)
+			{
+				return _mm_shuffle_epi8(pack, ByteShuffleControl<false, Sources...>().pack);
+			}
 		}
 
 		if constexpr (is256)
 		{
+			// int64 and uint64
+			if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) == 8)
+			{
+				constexpr int32_t mask = ToControlMask<2, Sources...>();
+				return _mm256_permute4x64_epi64(pack, mask);
+			}
+
+			// 32 bit elements staying within their 128 bit lane, with the same pattern in both, or moving in pairs
+			// have immediate forms, which don't need a control vector
+			if constexpr (sizeof(ValTy) == 4 && LaneShuffleImmediate<false, Sources...>() >= 0)
+			{
+				constexpr int mask = LaneShuffleImmediate<false, Sources...>();
+				if constexpr (std::is_same_v<ValTy, float>) return _mm256_permute_ps(pack, mask);
+				else return _mm256_shuffle_epi32(pack, mask);
+			}
+			if constexpr (sizeof(ValTy) == 4 && PairImmediate<Sources...>() >= 0)
+			{
+				constexpr int mask = PairImmediate<Sources...>();
+				if constexpr (std::is_same_v<ValTy, float>) return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(pack), mask));
+				else return _mm256_permute4x64_epi64(pack, mask);
+			}
+
+			// int32 and uint32
+			if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) == 4)
+			{
+				return _mm256_permutevar8x32_epi32(pack, _mm256_setr_epi32(static_cast<int>(Sources)...));
+			}
+
+			// int8, uint8, int16 and uint16 staying within their 128 bit lane
+			if constexpr (std::is_integral_v<ValTy> && !CrossesLanes<Sources...>())
+			{
+				return _mm256_shuffle_epi8(pack, ByteShuffleControl<false, Sources...>().pack);
+			}
+
+			// int8, uint8, int16 and uint16
+			if constexpr (std::is_integral_v<ValTy>)
+			{
+				// Shuffle within each lane, then again with the lanes swapped, each shuffle zeroing the bytes the other provides
+				__m256i swapped = _mm256_permute4x64_epi64(pack, 0b01'00'11'10);
+				__m256i sameLane = _mm256_shuffle_epi8(pack, ByteShuffleControl<false, Sources...>().pack);
+				__m256i otherLane = _mm256_shuffle_epi8(swapped, ByteShuffleControl<true, Sources...>().pack);
+				return _mm256_or_si256(sameLane, otherLane);
+			}
+
 			// double
 			if constexpr (std::is_same_v<ValTy, double>)
 			{
-				return _mm256_permute4x64_pd(pack, ToControlMask<2, Sources...>());
-			}
-
-			if constexpr (std::is_same_v<ValTy, float>)
+				constexpr int32_t mask = ToControlMask<2, Sources...>();
+				return _mm256_permute4x64_pd(pack, mask);
+			}
+
+			if constexpr (std::is_same_v<ValTy, float>)
+			{
+				return _mm256_permutevar8x32_ps(pack, _mm256_setr_epi32(static_cast<int>(Sources)...));
+			}
+		}
+
+#if WRAPPERSIMD_AVX512
+		if constexpr (is512)
+		{
+			if constexpr (sizeof(ValTy) == 4 && LaneShuffleImmediate<false, Sources...>() >= 0)
+			{
+				constexpr int mask = LaneShuffleImmediate<false, Sources...>();
+				if constexpr (std::is_same_v<ValTy, float>) return _mm512_permute_ps(pack, mask);
+				else return _mm512_shuffle_epi32(pack, static_cast<_MM_PERM_ENUM>(mask));
+			}
+
+			// Every element size has a full cross-lane permute, taking the indices first
+			if constexpr (std::is_same_v<ValTy, float>)
+				return _mm512_permutexvar_ps(ValuePack<int32_t, 16>{ static_cast<int32_t>(Sources)... }.pack, pack);
+			if constexpr (std::is_same_v<ValTy, double>)
+				return _mm512_permutexvar_pd(ValuePack<int64_t, 8>{ static_cast<int64_t>(Sources)... }.pack, pack);
+			if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) == 8)
+				return _mm512_permutexvar_epi64(ValuePack<int64_t, 8>{ static_cast<int64_t>(Sources)... }.pack, pack);
+			if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) == 4)
+				return _mm512_permutexvar_epi32(ValuePack<int32_t, 16>{ static_cast<int32_t>(Sources)... }.pack, pack);
+			if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) == 2)
+				return _mm512_permutexvar_epi16(ValuePack<int16_t, 32>{ static_cast<int16_t>(Sources)... }.pack, pack);
+
+			if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) == 1 && WRAPPERSIMD_AVX512VBMI)
+				return _mm512_permutexvar_epi8(ValuePack<int8_t, 64>{ static_cast<int8_t>(Sources)... }.pack, pack);
+
+			// Bytes staying within their 128 bit block only need 'pshufb'
+			if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) == 1 && !CrossesLanes<Sources...>())
+				return _mm512_shuffle_epi8(pack, ValuePack<int8_t, 64>{ static_cast<int8_t>(Sources % 16)... }.pack);
+
+			if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) == 1)
+				return PermuteBytes(pack, ValuePack<int8_t, 64>{ static_cast<int8_t>(Sources)... }.pack);
+		}
+#endif
+
+		throw;
+	}
+
+	// Takes the element from 'other' in each lane where 'FromOther' is true
+	template <bool... FromOther>
+	inline ValuePack Blend(ValuePack other) const
+	{
+		static_assert(sizeof...(FromOther) == PackSize, "Blend mask must have same size as pack");
+
+		// Bit i is set when lane i comes from 'other', as the immediate blend instructions expect
+		static constexpr uint64_t bits = []
+		{
+			uint64_t ret = 0;
+			size_t i = 0;
+			((ret |= uint64_t{ FromOther } << i++), ...);
+			return ret;
+		}();
+
+		if constexpr (is512)
+		{
+			using Mask = BoolPack<PackSize, sizeof(ValTy)>;
+			return select(Mask(static_cast<typename Mask::MaskTy>(bits)), other, *this);
+		}
+		else if constexpr (std::is_floating_point_v<ValTy>)
+		{
+			RETURN_OP(bitWidth, blend, ValTy, pack, other.pack, (int)bits);
+		}
+		else if constexpr (sizeof(ValTy) >= 4)
+		{
+			// Reuse the floating point blends, which exist for every width without AVX2
+			using FloatTy = std::conditional_t<sizeof(ValTy) == 4, float, double>;
+			ValuePack self = *this;
+			return self.template Cast<FloatTy>().template Blend<FromOther...>(other.template Cast<FloatTy>()).template Cast<ValTy>();
+		}
+		else if constexpr (sizeof(ValTy) == 2 && bitWidth == 128)
+		{
+			return _mm_blend_epi16(pack, other.pack, (int)bits);
+		}
+		else
+		{
+			// No immediate form for bytes, and the 256 bit 16 bit blend repeats its immediate in each 128 bit lane
+			using IntTy = std::make_signed_t<ValTy>;
+			ValuePack<IntTy, PackSize> mask = ValuePack<IntTy, PackSize>::Set((FromOther ? IntTy(-1) : IntTy(0))...);
+			return select(BoolPack<PackSize, sizeof(ValTy)>(mask.pack), other, *this);
+		}
+	}
+
+	// Element i becomes element 'indices[i]' of this pack, with indices chosen at runtime.
+	// Indices must be in [0, PackSize)
+	inline ValuePack Shuffle(ValuePack<LaneIntTy, PackSize> indices) const
+	{
+		ValuePack self = *this;
+		if constexpr (is512)
+		{
+			if constexpr (std::is_same_v<ValTy, float>) return _mm512_permutexvar_ps(indices.pack, pack);
+			else if constexpr (std::is_same_v<ValTy, double>) return _mm512_permutexvar_pd(indices.pack, pack);
+			else if constexpr (sizeof(ValTy) == 1 && !WRAPPERSIMD_AVX512VBMI) return PermuteBytes(pack, indices.pack);
+			else
+			{
+				RETURN_OP_WITH_SIZE(512, permutexvar, LaneIntTy, indices.pack, pack);
+			}
+		}
+		else if constexpr (is256 && sizeof(ValTy) == 4)
+		{
+			if constexpr (std::is_same_v<ValTy, float>) return _mm256_permutevar8x32_ps(pack, indices.pack);
+			else return _mm256_permutevar8x32_epi32(pack, indices.pack);
+		}
+		else if constexpr (is256 && sizeof(ValTy) == 8 && WRAPPERSIMD_AVX512VL)
+		{
+			if constexpr (std::is_same_v<ValTy, double>) return _mm256_permutexvar_pd(indices.pack, pack);
+			else return _mm256_permutexvar_epi64(indices.pack, pack);
+		}
+		else if constexpr (is256 && sizeof(ValTy) == 8)
+		{
+			// Each element moves as a pair of 32 bit elements, 2i and 2i + 1
+			__m256i doubled = _mm256_slli_epi64(indices.pack, 1);
+			__m256i pairs = _mm256_or_si256(doubled, _mm256_slli_epi64(_mm256_add_epi64(doubled, _mm256_set1_epi64x(1)), 32));
+			return ValuePack<LaneIntTy, PackSize>(_mm256_permutevar8x32_epi32(self.template Cast<LaneIntTy>().pack, pairs)).template Cast<ValTy>();
+		}
+		else if constexpr (is256 && sizeof(ValTy) == 2 && WRAPPERSIMD_AVX512VL)
+		{
+			return _mm256_permutexvar_epi16(indices.pack, pack);
+		}
+		else if constexpr (bitWidth == 128 && sizeof(ValTy) == 4 && WRAPPERSIMD_VEX)
+		{
+			__m128 floats = self.template Cast<float>().pack;
+			return ValuePack<float, 4>(_mm_permutevar_ps(floats, indices.pack)).template Cast<ValTy>();
+		}
+		else
+		{
+			// Byte shuffles, with each element index expanded to the indices of its bytes
+			auto bytes = indices.pack;
+			if constexpr (sizeof(ValTy) > 1)
+			{
+				constexpr int scale = std::countr_zero(sizeof(ValTy));
+				ValuePack<LaneIntTy, PackSize> firstBytes = indices << scale;
+				ValuePack<int8_t, bitWidth / 8> lowByte, byteOffset;
+				for (size_t i = 0; i < bitWidth / 8; i++)
+				{
+					lowByte[i] = static_cast<int8_t>(i - i % sizeof(ValTy));
+					byteOffset[i] = static_cast<int8_t>(i % sizeof(ValTy));
+				}
+				// 'pshufb' stays within 128 bit lanes, which is where the low byte of each element is
+				if constexpr (is256) bytes = _mm256_add_epi8(_mm256_shuffle_epi8(firstBytes.pack, lowByte.pack), byteOffset.pack);
+				else bytes = _mm_add_epi8(_mm_shuffle_epi8(firstBytes.pack, lowByte.pack), byteOffset.pack);
+			}
+
+			auto ints = self.template Cast<LaneIntTy>().pack;
+			if constexpr (is256)
+			{
+				// As for Permute, shuffle the same and the swapped lanes. Indices from the wrong lane end up at 16 or
+				// above, which saturating into the 0x80 range makes 'pshufb' zero
+				__m256i destLane = _mm256_setr_epi64x(0, 0, 0x1010'1010'1010'1010, 0x1010'1010'1010'1010);
+				__m256i saturate = _mm256_set1_epi8(0x70);
+				__m256i sameControl = _mm256_adds_epu8(_mm256_xor_si256(bytes, destLane), saturate);
+				__m256i otherControl = _mm256_adds_epu8(_mm256_xor_si256(bytes, _mm256_xor_si256(destLane, _mm256_set1_epi8(16))), saturate);
+				__m256i swapped = _mm256_permute4x64_epi64(ints, 0b01'00'11'10);
+				ints = _mm256_or_si256(_mm256_shuffle_epi8(ints, sameControl), _mm256_shuffle_epi8(swapped, otherControl));
+			}
+			else
+			{
+				ints = _mm_shuffle_epi8(ints, bytes);
+			}
+			return ValuePack<LaneIntTy, PackSize>(ints).template Cast<ValTy>();
+		}
+	}
+
+	// Two source Permute: element i becomes element Sources[i] of this pack, or Sources[i] - PackSize of 'other'
+	template <size_t... Sources>
+	inline ValuePack Shuffle2(ValuePack other) const
+	{
+		static_assert(sizeof...(Sources) == PackSize, "Shuffle2 sources must have same size as pack");
+		static_assert((... && (Sources < 2 * PackSize)), "Shuffle2 sources out of range");
+
+		constexpr size_t sources[] = { Sources... };
+		constexpr bool identity = []
+		{
+			for (size_t i = 0; i < PackSize; i++)
+				if (sources[i] % PackSize != i) return false;
+			return true;
+		}();
+
+		ValuePack self = *this;
+		if constexpr (identity)
+			return Blend<(Sources >= PackSize)...>(other);
+		else if constexpr (IsUnpackPattern<false, Sources...>())
+		{
+			RETURN_OP(bitWidth, unpacklo, SignlessTy<ValTy>, pack, other.pack);
+		}
+		else if constexpr (IsUnpackPattern<true, Sources...>())
+		{
+			RETURN_OP(bitWidth, unpackhi, SignlessTy<ValTy>, pack, other.pack);
+		}
+		else if constexpr (sizeof(ValTy) == 4 && LaneShuffleImmediate<true, Sources...>() >= 0)
+		{
+			constexpr int mask = LaneShuffleImmediate<true, Sources...>();
+			ValuePack<float, PackSize> floats = self.template Cast<float>();
+			ValuePack<float, PackSize> otherFloats = other.template Cast<float>();
+			if constexpr (bitWidth == 128) floats = _mm_shuffle_ps(floats.pack, otherFloats.pack, mask);
+			else if constexpr (bitWidth == 256) floats = _mm256_shuffle_ps(floats.pack, otherFloats.pack, mask);
+			else floats = _mm512_shuffle_ps(floats.pack, otherFloats.pack, mask);
+			return floats.template Cast<ValTy>();
+		}
+		else if constexpr (is256 && HalfMoveImmediate<Sources...>() >= 0)
+		{
+			constexpr int mask = HalfMoveImmediate<Sources...>();
+			if constexpr (std::is_same_v<ValTy, float>) return _mm256_permute2f128_ps(pack, other.pack, mask);
+			else if constexpr (std::is_same_v<ValTy, double>) return _mm256_permute2f128_pd(pack, other.pack, mask);
+			else return _mm256_permute2x128_si256(pack, other.pack, mask);
+		}
+		else if constexpr (is512 && (sizeof(ValTy) > 1 || WRAPPERSIMD_AVX512VBMI))
+		{
+			// Two source permutes take the indices between the sources
+			ValuePack<LaneIntTy, PackSize> indices = ValuePack<LaneIntTy, PackSize>::Set(static_cast<LaneIntTy>(Sources)...);
+			if constexpr (std::is_same_v<ValTy, float>) return _mm512_permutex2var_ps(pack, indices.pack, other.pack);
+			else if constexpr (std::is_same_v<ValTy, double>) return _mm512_permutex2var_pd(pack, indices.pack, other.pack);
+			else
+			{
+				RETURN_OP_WITH_SIZE(512, permutex2var, LaneIntTy, pack, indices.pack, other.pack);
+			}
+		}
+		else
+		{
+			// Permute both packs into place, then blend. Also 512 bit bytes without AVX512-VBMI's 'vpermt2b'
+			ValuePack fromThis = Permute<(Sources % PackSize)...>();
+			ValuePack fromOther = other.template Permute<(Sources % PackSize)...>();
+			return fromThis.template Blend<(Sources >= PackSize)...>(fromOther);
+		}
+	}
+
+	// Element i becomes element (i + K) % PackSize, as std::rotate with element K becoming the first
+	template <size_t K>
+	inline ValuePack Rotate() const
+	{
+		constexpr size_t k = K % PackSize;
+		ValuePack self = *this;
+		if constexpr (k == 0)
+			return *this;
+		else if constexpr (bitWidth == 128)
+		{
+			auto ints = self.template Cast<LaneIntTy>().pack;
+			return ValuePack<LaneIntTy, PackSize>(_mm_alignr_epi8(ints, ints, k * sizeof(ValTy))).template Cast<ValTy>();
+		}
+		else if constexpr (is512 && sizeof(ValTy) >= 4)
+		{
+			auto ints = self.template Cast<LaneIntTy>().pack;
+			if constexpr (sizeof(ValTy) == 4) return ValuePack<LaneIntTy, PackSize>(_mm512_alignr_epi32(ints, ints, k)).template Cast<ValTy>();
+			else return ValuePack<LaneIntTy, PackSize>(_mm512_alignr_epi64(ints, ints, k)).template Cast<ValTy>();
+		}
+		else
+		{
+			return [&]<size_t... Lanes>(std::index_sequence<Lanes...>)
+			{
+				return Permute<((Lanes + k) % PackSize)...>();
+			}(std::make_index_sequence<PackSize>());
+		}
+	}
+
+	// Moves every element K lanes towards the end of the pack, or towards the start for negative K, filling with zeros
+	template <int K>
+	inline ValuePack ShiftLanes() const
+	{
+		if constexpr (K == 0)
+			return *this;
+		else if constexpr (K >= static_cast<int>(PackSize) || -K >= static_cast<int>(PackSize))
+			return RepVal(0);
+		else if constexpr (K > 0)
+			return ShiftUp<K * sizeof(ValTy)>();
+		else
+			return ShiftDown<-K * sizeof(ValTy)>();
+	}
+
+	// Every element becomes element 'Lane'
+	template <size_t Lane>
+	inline ValuePack Broadcast() const
+	{
+		static_assert(Lane < PackSize, "Broadcast lane out of range");
+		if constexpr (is512 && sizeof(ValTy) == 1)
+		{
+			// 'vpermb' needs AVX512-VBMI. Broadcast the containing 32 bit element, then pick the byte in each lane
+			__m512i dwords = _mm512_permutexvar_epi32(_mm512_set1_epi32(Lane / 4), pack);
+			return _mm512_shuffle_epi8(dwords, _mm512_set1_epi8(Lane % 4));
+		}
+		else
+		{
+			return [&]<size_t... Lanes>(std::index_sequence<Lanes...>)
+			{
+				return Permute<(static_cast<void>(Lanes), Lane)...>();
+			}(std::make_index_sequence<PackSize>());
+		}
+	}
+
+	// Reverses the order of the elements
+	inline ValuePack Reverse() const
+	{
+		if constexpr (is512 && sizeof(ValTy) == 1 && !WRAPPERSIMD_AVX512VBMI)
+		{
+			// Without 'vpermb', reverse the bytes of each 128 bit block, then the order of the blocks
+			__m512i control = _mm512_broadcast_i32x4(_mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+			__m512i reversedBlocks = _mm512_shuffle_epi8(pack, control);
+			return _mm512_shuffle_i64x2(reversedBlocks, reversedBlocks, 0b00'01'10'11);
+		}
+		else
+		{
+			return [&]<size_t... Lanes>(std::index_sequence<Lanes...>)
+			{
+				return Permute<(PackSize - 1 - Lanes)...>();
+			}(std::make_index_sequence<PackSize>());
+		}
+	}
+
+	// Interleaves the lower halves of this pack and 'other': this[0], other[0], this[1], other[1]...
+	inline ValuePack InterleaveLo(ValuePack other) const
+	{
+		return Interleave<false>(other);
+	}
+
+	// Interleaves the upper halves of this pack and 'other'
+	inline ValuePack InterleaveHi(ValuePack other) const
+	{
+		return Interleave<true>(other);
+	}
+
+	// Transposes the square matrix with one row per pack, in registers.
+	// For example 4x4 doubles in 256 bit packs, 8x8 floats in 256 bit packs or 16x16 bytes in 128 bit packs
+	static void Transpose(std::array<ValuePack, PackSize>& rows)
+	{
+		// Move whole 128 bit blocks into place, then transpose within each block
+		TransposeBlocks<PackSize / 2>(rows);
+		TransposeLanes<std::countr_zero(16 / sizeof(ValTy))>(rows);
+	}
+
+	// Sorts the elements in ascending order, with a bitonic network of min / max stages.
+	// Floating point elements must not be NaN
+	inline ValuePack Sort() const
+	{
+		return BitonicStages<2, 1>();
+	}
+
+	// Running sums, element i becoming the sum of elements 0 to i, in log2(PackSize) shift and add steps.
+	// Integer sums wrap around, and floating point sums are associated differently from a sequential loop
+	inline ValuePack InclusiveScan() const
+	{
+		ValuePack ret = *this;
+		if constexpr (is256)
+		{
+			// Scan each 128 bit lane with in-lane shifts, which are cheaper than those crossing lanes,
+			// then add the lower lane's total to the upper lane
+			[&]<size_t... Steps>(std::index_sequence<Steps...>)
+			{
+				((ret = ret + ret.template ShiftUpInLanes<(sizeof(ValTy) << Steps)>()), ...);
+			}(std::make_index_sequence<std::bit_width(16 / sizeof(ValTy)) - 1>());
+			return ret + ret.LaneLast().template ShiftUp<16>();
+		}
+		else
+		{
+			// 128 bit shifts never cross lanes, and 512 bit 'valignd' shifts across the whole register at once
+			[&]<size_t... Steps>(std::index_sequence<Steps...>)
 			{
-				return _mm256_permutevar8x32_ps(pack, ValuePack<int32_t, 8>{ static_cast<int32_t>(Sources)... }.pack);
-			}
+				((ret = ret + ret.template ShiftUp<(sizeof(ValTy) << Steps)>()), ...);
+			}(std::make_index_sequence<std::bit_width(PackSize) - 1>());
+			return ret;
 		}
+	}
 
-		throw;
+	// Element i becomes the sum of elements 0 to i - 1, the first element becoming 0
+	inline ValuePack ExclusiveScan() const
+	{
+		return InclusiveScan().template ShiftUp<sizeof(ValTy)>();
 	}
 
 	// == Numerical operations ==
 	// With other packs
-	ADD_OP_METHOD(+, add);
-	ADD_OP_METHOD(-, sub);
-	ADD_OP_METHOD(*, mul);
+	ADD_SIGNLESS_OP_METHOD(+, add);
+	ADD_SIGNLESS_OP_METHOD(-, sub);
 	ADD_OP_METHOD(/, div);
 	ADD_OP_METHOD(%, rem);
 	ADD_BITWISE_METHOD(&, and);
 	ADD_BITWISE_METHOD(|, or);
 	ADD_BITWISE_METHOD(^, xor);
 
+	// Integer products keep the low half, wrapping like the scalar types
+	inline ValuePack operator*(ValuePack other) const
+	{
+		if constexpr (std::is_floating_point_v<ValTy>)
+		{
+			RETURN_OP(bitWidth, mul, ValTy, pack, other.pack);
+		}
+		else if constexpr (sizeof(ValTy) == 2 || sizeof(ValTy) == 4 || (sizeof(ValTy) == 8 && WRAPPERSIMD_AVX512DQ && (is512 || WRAPPERSIMD_AVX512VL)))
+		{
+			// 'vpmullq' needs AVX512DQ, and AVX512VL for 128 and 256 bit packs
+			RETURN_OP(bitWidth, mullo, SignlessTy<ValTy>, pack, other.pack);
+		}
+		else if constexpr (sizeof(ValTy) == 8)
+		{
+			// lo(a) * lo(b) + (hi(a) * lo(b) + lo(a) * hi(b)) << 32, from three 32 x 32 -> 64 bit multiplies
+			using U64 = ValuePack<uint64_t, PackSize>;
+			U64 a = pack;
+			U64 b = other.pack;
+			U64 cross = MulLow32(a >> 32, b) + MulLow32(a, b >> 32);
+			return (MulLow32(a, b) + (cross << 32)).pack;
+		}
+		else
+		{
+			// No byte multiply, multiply the even and odd bytes separately as 16 bit elements
+			using I16 = ValuePack<int16_t, PackSize / 2>;
+			I16 a = pack;
+			I16 b = other.pack;
+			I16 even = a * b;
+			I16 odd = (a >> 8) * (b >> 8);
+			return ((odd << 8) | (even & static_cast<int16_t>(0x00FF))).pack;
+		}
+	}
+
+	// Masked, with other packs
+	ADD_MASKED_METHOD(MaskedAdd, +, add);
+	ADD_MASKED_METHOD(MaskedSub, -, sub);
+	ADD_MASKED_METHOD(MaskedMul, *, mul);
+	ADD_MASKED_METHOD(MaskedDiv, /, div);
+
 	// In place with packs
 	ADD_IN_PLACE_METHOD(+);
 	ADD_IN_PLACE_METHOD(-);
@@ -659,11 +2440,11 @@ public:
 		static_assert(!std::is_unsigned_v<ValTy>, "Cannot apply unary minus to unsigned type");
 		if constexpr (std::is_floating_point_v<ValTy>)
 		{
-			RETURN_OP(is256, xor, ValTy, pack, RepVal(-0.0).pack);
+			RETURN_OP(bitWidth, xor, ValTy, pack, RepVal(-0.0).pack);
 		}
 		else
 		{
-			// TODO - Unary minus on integer types
+			return RepVal(0) - (*this);
 		}
 	}
 
@@ -684,43 +2465,77 @@ public:
 	inline ValuePack operator<<(ValuePack other) const
 	{
 		using UValTy = std::make_signed_t<ValTy>;
-		RETURN_OP(is256, sllv, UValTy, pack, other.pack);
+		RETURN_OP(bitWidth, sllv, UValTy, pack, other.pack);
 	}
 	inline ValuePack operator>>(ValuePack other) const
 	{
-		static_assert(!std::is_same_v<ValTy, int64_t>, "Arithmetic right shift is not supported on signed 64 bit integers in SSE / AVX");
-
-		if constexpr (std::is_unsigned_v<ValTy>)
+		// 'vpsraq' needs AVX-512, and AVX512VL for 128 and 256 bit packs
+		if constexpr (std::is_same_v<ValTy, int64_t> && !(is512 || WRAPPERSIMD_AVX512VL))
+		{
+			// Shift the complement of negative elements logically, then complement back
+			ValuePack sign = SignMask();
+			return (((*this) ^ sign).template Cast<uint64_t>() >> other.template Cast<uint64_t>()).template Cast<int64_t>() ^ sign;
+		}
+		else if constexpr (std::is_unsigned_v<ValTy>)
 		{
 			// epu32, epu64
 			using UValTy = std::make_signed_t<ValTy>;
-			RETURN_OP(is256, srlv, UValTy, pack, other.pack);
+			RETURN_OP(bitWidth, srlv, UValTy, pack, other.pack);
 		}
 		else
 		{
 			// epi32
-			RETURN_OP(is256, srav, ValTy, pack, other.pack);
+			RETURN_OP(bitWidth, srav, ValTy, pack, other.pack);
 		}
 	}
 	inline ValuePack operator<<(int x) const
 	{
-		using UValTy = std::make_signed_t<ValTy>;
-		RETURN_OP(is256, slli, UValTy, pack, x);
+		if constexpr (sizeof(ValTy) == 1)
+		{
+			// No byte shifts, shift 16 bit elements and clear the bits which crossed into the next byte
+			using U16 = ValuePack<uint16_t, PackSize / 2>;
+			uint16_t keep = static_cast<uint16_t>(0x0101 * ((0xFF << x) & 0xFF));
+			return ((U16(pack) << x) & keep).pack;
+		}
+		else
+		{
+			using UValTy = std::make_signed_t<ValTy>;
+			RETURN_OP(bitWidth, slli, UValTy, pack, x);
+		}
 	}
 	inline ValuePack operator>>(int x) const
 	{
-		static_assert(!std::is_same_v<ValTy, int64_t>, "Arithmetic right shift is not supported on signed 64 bit integers in SSE / AVX");
-
-		if constexpr (std::is_unsigned_v<ValTy>)
+		if constexpr (sizeof(ValTy) == 1)
+		{
+			using U16 = ValuePack<uint16_t, PackSize / 2>;
+			if constexpr (std::is_unsigned_v<ValTy>)
+			{
+				uint16_t keep = static_cast<uint16_t>(0x0101 * (0xFF >> x));
+				return ((U16(pack) >> x) & keep).pack;
+			}
+			else
+			{
+				// Shift logically, then sign extend from the shifted sign bit: (v ^ m) - m
+				x = std::min(x, 7);
+				ValuePack signBit = static_cast<ValTy>(0x80 >> x);
+				return ((ValuePack<uint8_t, PackSize>(pack) >> x).template Cast<ValTy>() ^ signBit) - signBit;
+			}
+		}
+		else if constexpr (std::is_same_v<ValTy, int64_t> && !(is512 || WRAPPERSIMD_AVX512VL))
+		{
+			ValuePack sign = SignMask();
+			return (((*this) ^ sign).template Cast<uint64_t>() >> x).template Cast<int64_t>() ^ sign;
+		}
+		else if constexpr (std::is_unsigned_v<ValTy>)
 		{
 			// epu16, epu32, epu64
 			using UValTy = std::make_signed_t<ValTy>;
-			RETURN_OP(is256, srli, UValTy, pack, x);
+			RETURN_OP(bitWidth, srli, UValTy, pack, x);
 		}
 		else
 		{
-			// epi16, epi32
-			RETURN_OP(is256, srai, ValTy, pack, x);
+			// epi16, epi32, and epi64 with AVX-512
+			RETURN_OP(bitWidth, srai, ValTy, pack, x);
 		}
 	}
 	inline ValuePack& operator<<=(int x)
@@ -767,6 +2582,8 @@ public:
 	ADD_FREE_FRIEND(floor);
 	ADD_FREE_FRIEND(round);
 	ADD_FREE_FRIEND(ceil);
+	ADD_FREE_FRIEND(trunc);
+	ADD_FREE_FRIEND(rint);
 
 	// Simple
 	ADD_FREE_FRIEND(abs);
@@ -776,19 +2593,69 @@ public:
 	ADD_FREE_FRIEND_2ARG(adds);
 	ADD_FREE_FRIEND_2ARG(subs);
 
+	// Fused multiply-add
+	ADD_FREE_FRIEND_3ARG(fma);
+	ADD_FREE_FRIEND_3ARG(fms);
+	ADD_FREE_FRIEND_3ARG(fnma);
+	ADD_FREE_FRIEND_3ARG(fnms);
+	ADD_FREE_FRIEND_3ARG(fmaddsub);
+	ADD_FREE_FRIEND_3ARG(fmsubadd);
+
 	// Special
 	ADD_FREE_FRIEND(erf);
 
-	template <ComparisonOperator op, typename ValTy, size_t PackSize>
-	friend BoolPack<PackSize, sizeof(ValTy)> cmp(ValuePack<ValTy, PackSize> pack1, ValuePack<ValTy, PackSize> pack2);
+	template <typename ValTy2, size_t PackSize2>
+	friend ValuePack<ValTy2, PackSize2> select(BoolPack<PackSize2, sizeof(ValTy2)> mask, ValuePack<ValTy2, PackSize2> a, ValuePack<ValTy2, PackSize2> b);
+
+	template <typename ValTy2, size_t PackSize2>
+	friend std::pair<ValuePack<ValTy2, PackSize2>, ValuePack<ValTy2, PackSize2>> merge(ValuePack<ValTy2, PackSize2> a, ValuePack<ValTy2, PackSize2> b);
+
+	template <ComparisonOperator op, typename ValTy2, size_t PackSize2>
+	friend BoolPack<PackSize2, sizeof(ValTy2)> cmp(ValuePack<ValTy2, PackSize2> pack1, ValuePack<ValTy2, PackSize2> pack2);
 
 	template <size_t NumElem, size_t ElemSize>
 	friend class BoolPack;
+
+	template <typename ValTy2, size_t PackSize2>
+	friend class ValuePack;
 	
 	PackTy pack;
 };
 
 // == Free functions ==
+// Lane-wise 'mask ? a : b'
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> select(BoolPack<PackSize, sizeof(ValTy)> mask, ValuePack<ValTy, PackSize> a, ValuePack<ValTy, PackSize> b)
+{
+	if constexpr (a.is512)
+	{
+		// Mask register blends take the second source where the mask is set
+		if constexpr (std::is_floating_point_v<ValTy>)
+		{
+			RETURN_OP_WITH_SIZE(512, mask_blend, ValTy, mask.d, b.pack, a.pack);
+		}
+		else
+		{
+			using OpTy = std::make_signed_t<ValTy>;
+			RETURN_OP_WITH_SIZE(512, mask_blend, OpTy, mask.d, b.pack, a.pack);
+		}
+	}
+	else if constexpr (std::is_floating_point_v<ValTy>)
+	{
+		// 'blendv' only reads the top bit of each element, BoolPack lanes have every bit set
+		RETURN_OP(a.bitWidth, blendv, ValTy, b.pack, a.pack, mask.template Cast<ValTy>().pack);
+	}
+	else if constexpr (a.is256)
+	{
+		return _mm256_blendv_epi8(b.pack, a.pack, mask.template Cast<ValTy>().pack);
+	}
+	else
+	{
+		return _mm_blendv_epi8(b.pack, a.pack, mask.template Cast<ValTy>().pack);
+	}
+}
+
+#if WRAPPERSIMD_SVML
 // Trig functions
 ADD_FREE_FUNC(sin, sin);
 ADD_FREE_FUNC(cos, cos);
@@ -809,38 +2676,235 @@ ADD_FREE_FUNC(exp, exp);
 ADD_FREE_FUNC(log, log);
 ADD_FREE_FUNC(log2, log2);
 ADD_FREE_FUNC(log10, log10);
-ADD_FREE_FUNC(sqrt, sqrt);
 ADD_FREE_FUNC(cbrt, cbrt);
 ADD_FREE_FUNC(invsqrt, invsqrt);
-ADD_FREE_FUNC(invsqrt_approx, rsqrt);
 ADD_FREE_FUNC(invcbrt, invcbrt);
 ADD_FREE_FUNC_2ARG(pow, pow);
 
+// Special
+ADD_FREE_FUNC(erf, erf);
+#endif
+
+ADD_FREE_FUNC(sqrt, sqrt);
+ADD_FREE_FUNC(invsqrt_approx, rsqrt);
+
 // Other functions
 // Rounding
 ADD_FREE_FUNC(floor, floor);
-ADD_FREE_FUNC(round, round);
 ADD_FREE_FUNC(ceil, ceil);
+ADD_ROUND_FUNC(trunc, _MM_FROUND_TO_ZERO);
+ADD_ROUND_FUNC(rint, _MM_FROUND_TO_NEAREST_INT);
+
+// Rounds half away from zero, matching std::round
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> round(ValuePack<ValTy, PackSize> pack)
+{
+	ValuePack<ValTy, PackSize> truncated = trunc(pack);
+	ValuePack<ValTy, PackSize> signBit = pack & static_cast<ValTy>(-0.0);
+	BoolPack<PackSize, sizeof(ValTy)> roundAway = ((pack - truncated) ^ signBit) >= static_cast<ValTy>(0.5);
+	ValuePack<ValTy, PackSize> awayFromZero = truncated + (signBit | static_cast<ValTy>(1.0));
+	return select(roundAway, awayFromZero, truncated);
+}
 
 // Simple
-ADD_FREE_FUNC(abs, abs);
-ADD_FREE_FUNC_2ARG(min, min);
-ADD_FREE_FUNC_2ARG(max, max);
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> abs(ValuePack<ValTy, PackSize> pack)
+{
+	if constexpr (std::is_floating_point_v<ValTy>)
+	{
+		// Clear the sign bit
+		ValuePack<ValTy, PackSize> signBit = static_cast<ValTy>(-0.0);
+		RETURN_OP(pack.bitWidth, andnot, ValTy, signBit.pack, pack.pack);
+	}
+	else if constexpr (sizeof(ValTy) == 8 && !(pack.is512 || WRAPPERSIMD_AVX512VL))
+	{
+		// There is no packed 64 bit integer 'abs' before AVX-512, nor for 128 and 256 bit packs before AVX512VL
+		return select(pack < static_cast<ValTy>(0), -pack, pack);
+	}
+	else
+	{
+		RETURN_OP(pack.bitWidth, abs, ValTy, pack.pack);
+	}
+}
+
+// There is no packed 64 bit integer 'min' or 'max' before AVX-512, nor for 128 and 256 bit packs before AVX512VL,
+// compare and select instead
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> min(ValuePack<ValTy, PackSize> pack1, ValuePack<ValTy, PackSize> pack2)
+{
+	if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) == 8 && !(pack1.is512 || WRAPPERSIMD_AVX512VL))
+		return select(pack1 < pack2, pack1, pack2);
+	else
+	{
+		RETURN_OP(pack1.bitWidth, min, ValTy, pack1.pack, pack2.pack);
+	}
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> max(ValuePack<ValTy, PackSize> pack1, ValuePack<ValTy, PackSize> pack2)
+{
+	if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) == 8 && !(pack1.is512 || WRAPPERSIMD_AVX512VL))
+		return select(pack1 > pack2, pack1, pack2);
+	else
+	{
+		RETURN_OP(pack1.bitWidth, max, ValTy, pack1.pack, pack2.pack);
+	}
+}
+
 ADD_FREE_FUNC_2ARG(avg, avg);
 ADD_FREE_FUNC_2ARG(adds, adds);
 ADD_FREE_FUNC_2ARG(subs, subs);
 
-// Special
-ADD_FREE_FUNC(erf, erf);
+// Fused multiply-add, computing the product and sum with a single rounding where the target has FMA3 (AVX2 and
+// AVX-512 builds). Without it, as in the SSE4.2 build, the product is rounded first, so results may differ from std::fma
+ADD_FMA_FUNC(fma, fmadd, a * b + c);			// a * b + c
+ADD_FMA_FUNC(fms, fmsub, a * b - c);			// a * b - c
+ADD_FMA_FUNC(fnma, fnmadd, c - a * b);			// -(a * b) + c
+ADD_FMA_FUNC(fnms, fnmsub, -(a * b) - c);		// -(a * b) - c
+
+// Subtracts 'c' in even lanes and adds it in odd lanes, as in complex multiplication.
+// Without FMA3 this is SSE3's 'addsub', rounding the product first.
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> fmaddsub(ValuePack<ValTy, PackSize> a, ValuePack<ValTy, PackSize> b, ValuePack<ValTy, PackSize> c)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "fmaddsub requires a floating point pack");
+	if constexpr (WRAPPERSIMD_FMA || a.is512)
+	{
+		RETURN_OP(a.bitWidth, fmaddsub, ValTy, a.pack, b.pack, c.pack);
+	}
+	else
+	{
+		RETURN_OP_128_256(a.bitWidth, addsub, ValTy, (a * b).pack, c.pack);
+	}
+}
+
+// Adds 'c' in even lanes and subtracts it in odd lanes
+template <typename ValTy, size_t PackSize>
+inline ValuePack<ValTy, PackSize> fmsubadd(ValuePack<ValTy, PackSize> a, ValuePack<ValTy, PackSize> b, ValuePack<ValTy, PackSize> c)
+{
+	static_assert(std::is_floating_point_v<ValTy>, "fmsubadd requires a floating point pack");
+	if constexpr (WRAPPERSIMD_FMA || a.is512)
+	{
+		RETURN_OP(a.bitWidth, fmsubadd, ValTy, a.pack, b.pack, c.pack);
+	}
+	else
+	{
+		RETURN_OP_128_256(a.bitWidth, addsub, ValTy, (a * b).pack, (-c).pack);
+	}
+}
+
+// ===== Horizontal reductions =====
+namespace detail
+{
+	// Lower and upper halves of a 256 or 512 bit pack
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize / 2> LowHalf(ValuePack<ValTy, PackSize> pack)
+	{
+		if constexpr (sizeof(ValTy) * PackSize == 64)
+		{
+			if constexpr (std::is_same_v<ValTy, float>) return _mm512_castps512_ps256(pack.pack);
+			else if constexpr (std::is_same_v<ValTy, double>) return _mm512_castpd512_pd256(pack.pack);
+			else return _mm512_castsi512_si256(pack.pack);
+		}
+		else
+		{
+			if constexpr (std::is_same_v<ValTy, float>) return _mm256_castps256_ps128(pack.pack);
+			else if constexpr (std::is_same_v<ValTy, double>) return _mm256_castpd256_pd128(pack.pack);
+			else return _mm256_castsi256_si128(pack.pack);
+		}
+	}
+
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize / 2> HighHalf(ValuePack<ValTy, PackSize> pack)
+	{
+		if constexpr (sizeof(ValTy) * PackSize == 64)
+		{
+			// 'extractf32x8' needs AVX512DQ, go through the double form instead
+			if constexpr (std::is_same_v<ValTy, float>) return _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(pack.pack), 1));
+			else if constexpr (std::is_same_v<ValTy, double>) return _mm512_extractf64x4_pd(pack.pack, 1);
+			else return _mm512_extracti64x4_epi64(pack.pack, 1);
+		}
+		else
+		{
+			if constexpr (std::is_same_v<ValTy, float>) return _mm256_extractf128_ps(pack.pack, 1);
+			else if constexpr (std::is_same_v<ValTy, double>) return _mm256_extractf128_pd(pack.pack, 1);
+			else return _mm256_extractf128_si256(pack.pack, 1);
+		}
+	}
+
+	// Moves the element 'Bytes' into a 128 bit pack down to the first lane, other lanes are unspecified
+	template <size_t Bytes, typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> ShiftDown(ValuePack<ValTy, PackSize> pack)
+	{
+		// Floating point shuffles avoid a bypass delay between the integer and floating point domains
+		if constexpr (std::is_same_v<ValTy, float> && Bytes == 8) return _mm_movehl_ps(pack.pack, pack.pack);
+		else if constexpr (std::is_same_v<ValTy, float>) return _mm_movehdup_ps(pack.pack);
+		else if constexpr (std::is_same_v<ValTy, double>) return _mm_unpackhi_pd(pack.pack, pack.pack);
+		else return _mm_srli_si128(pack.pack, Bytes);
+	}
+
+	// First element of a 128 bit pack, read straight from the register
+	template <typename ValTy, size_t PackSize>
+	inline ValTy FirstLane(ValuePack<ValTy, PackSize> pack)
+	{
+		if constexpr (std::is_same_v<ValTy, float>) return _mm_cvtss_f32(pack.pack);
+		else if constexpr (std::is_same_v<ValTy, double>) return _mm_cvtsd_f64(pack.pack);
+		else if constexpr (sizeof(ValTy) == 8) return static_cast<ValTy>(_mm_cvtsi128_si64(pack.pack));
+		else return static_cast<ValTy>(_mm_cvtsi128_si32(pack.pack));
+	}
+
+	// Combines all elements with 'op', first by halving the pack down to 128 bits, then by shuffling within it
+	template <typename ValTy, size_t PackSize, typename Op>
+	inline ValTy HorizontalFold(ValuePack<ValTy, PackSize> pack, Op op)
+	{
+		if constexpr (sizeof(ValTy) * PackSize > 16)
+			return HorizontalFold(op(LowHalf(pack), HighHalf(pack)), op);
+		else
+		{
+			pack = op(pack, ShiftDown<8>(pack));
+			if constexpr (sizeof(ValTy) <= 4) pack = op(pack, ShiftDown<4>(pack));
+			if constexpr (sizeof(ValTy) <= 2) pack = op(pack, ShiftDown<2>(pack));
+			if constexpr (sizeof(ValTy) == 1) pack = op(pack, ShiftDown<1>(pack));
+			return FirstLane(pack);
+		}
+	}
+
+	// Adds adjacent pairs of 16 bit elements into 32 bit ones, which cannot overflow
+	template <size_t PackSize>
+	inline ValuePack<int32_t, PackSize / 2> PairwiseProducts(ValuePack<int16_t, PackSize> pack1, ValuePack<int16_t, PackSize> pack2)
+	{
+		if constexpr (PackSize == 32) return _mm512_madd_epi16(pack1.pack, pack2.pack);
+		else if constexpr (PackSize == 16) return _mm256_madd_epi16(pack1.pack, pack2.pack);
+		else return _mm_madd_epi16(pack1.pack, pack2.pack);
+	}
+}
 
 // 'sum' default algorithm
 template <typename ValTy, size_t PackSize>
 inline SumType<ValTy> sum(ValuePack<ValTy, PackSize> pack)
 {
-	SumType<ValTy> sum = pack[0];
-	for (size_t i = 1; i < PackSize; i++)
-		sum += pack[i];
-	return sum;
+	if constexpr (std::is_floating_point_v<ValTy> || sizeof(ValTy) >= 4)
+		return detail::HorizontalFold(pack, [](auto a, auto b) { return a + b; });
+	else if constexpr (sizeof(ValTy) == 2)
+	{
+		// Unsigned elements are biased into the signed range, then corrected once at the end
+		ValuePack<int16_t, PackSize> elems = pack.template Cast<int16_t>();
+		if constexpr (std::is_unsigned_v<ValTy>)
+			elems ^= ValuePack<int16_t, PackSize>(INT16_MIN);
+
+		ValuePack<int32_t, PackSize / 2> pairs = detail::PairwiseProducts(elems, ValuePack<int16_t, PackSize>(1));
+		int total = sum(pairs);
+		if constexpr (std::is_unsigned_v<ValTy>)
+			total += 32768 * (int)PackSize;
+		return total;
+	}
+	else
+	{
+		SumType<ValTy> sum = pack[0];
+		for (size_t i = 1; i < PackSize; i++)
+			sum += pack[i];
+		return sum;
+	}
 }
 
 // ===== 'sum' Specializations =====
@@ -849,9 +2913,10 @@ inline int64_t sum<int64_t, 2>(ValuePack<int64_t, 2> pack)
 {
 	__m128i shuffled = _mm_shuffle_epi32(pack.pack, 0b01'00'11'10);
 	__m128i sum = _mm_add_epi64(pack.pack, shuffled);
-	return sum.m128i_i64[0];
+	return _mm_cvtsi128_si64(sum);
 }
 
+#if WRAPPERSIMD_VEX
 template <>
 inline int sum<uint8_t, 32>(ValuePack<uint8_t, 32> pack)
 {
@@ -861,9 +2926,11 @@ inline int sum<uint8_t, 32>(ValuePack<uint8_t, 32> pack)
 	__m128i sum2 = _mm_add_epi64(low, high);
 	__m128i shuffled = _mm_shuffle_epi32(sum2, 0b01'00'11'10);
 	__m128i sum1 = _mm_add_epi64(sum2, shuffled);
-	return (int)sum1.m128i_i64[0];
+	return (int)_mm_cvtsi128_si64(sum1);
 }
+#endif
 
+#if WRAPPERSIMD_VEX
 template <>
 inline int64_t sum<int64_t, 4>(ValuePack<int64_t, 4> pack)
 {
@@ -872,16 +2939,18 @@ inline int64_t sum<int64_t, 4>(ValuePack<int64_t, 4> pack)
 	__m128i sum2 = _mm_add_epi64(low, high);
 	__m128i shuffled = _mm_shuffle_epi32(sum2, 0b01'00'11'10);
 	__m128i sum1 = _mm_add_epi64(sum2, shuffled);
-	return sum1.m128i_i64[0];
+	return _mm_cvtsi128_si64(sum1);
 }
+#endif
 
 template <>
 inline double sum<double, 2>(ValuePack<double, 2> pack)
 {
 	__m128d high64 = _mm_unpackhi_pd(pack.pack, pack.pack);
-	return _mm_add_sd(pack.pack, high64).m128d_f64[0];
+	return _mm_cvtsd_f64(_mm_add_sd(pack.pack, high64));
 }
 
+#if WRAPPERSIMD_VEX
 template <>
 inline double sum<double, 4>(ValuePack<double, 4> pack)
 {
@@ -890,21 +2959,24 @@ inline double sum<double, 4>(ValuePack<double, 4> pack)
 	__m128d sum2 = _mm_add_pd(low, high);
 
 	__m128d high64 = _mm_unpackhi_pd(sum2, sum2);
-	return _mm_add_sd(sum2, high64).m128d_f64[0];
+	return _mm_cvtsd_f64(_mm_add_sd(sum2, high64));
 }
+#endif
 
+#if WRAPPERSIMD_VEX
 template <>
 inline int sum<int8_t, 32>(ValuePack<int8_t, 32> pack)
 {
-	__m256i rangeShifted = _mm256_xor_si256(pack.pack, _mm256_set1_epi8(0b1000'0000i8));
+	__m256i rangeShifted = _mm256_xor_si256(pack.pack, _mm256_set1_epi8(static_cast<char>(0b1000'0000)));
 	__m256i sum4 = _mm256_sad_epu8(rangeShifted, _mm256_setzero_si256());
 	__m128i low = _mm256_extracti128_si256(sum4, 0);
 	__m128i high = _mm256_extracti128_si256(sum4, 1);
 	__m128i sum2 = _mm_add_epi64(low, high);
 	__m128i shuffled = _mm_shuffle_epi32(sum2, 0b01'00'11'10);
 	__m128i sum1 = _mm_add_epi64(sum2, shuffled);
-	return (int)(sum1.m128i_i64[0] - 4096);
+	return (int)(_mm_cvtsi128_si64(sum1) - 4096);
 }
+#endif
 
 template <>
 inline int sum<uint8_t, 16>(ValuePack<uint8_t, 16> pack)
@@ -912,17 +2984,239 @@ inline int sum<uint8_t, 16>(ValuePack<uint8_t, 16> pack)
 	__m128i sum2 = _mm_sad_epu8(pack.pack, _mm_setzero_si128());
 	__m128i shuffled = _mm_shuffle_epi32(sum2, 0b01'00'11'10);
 	__m128i sum1 = _mm_add_epi64(sum2, shuffled);
-	return (int)sum1.m128i_i64[0];
+	return (int)_mm_cvtsi128_si64(sum1);
 }
 
 template <>
 inline int sum<int8_t, 16>(ValuePack<int8_t, 16> pack)
 {
-	__m128i rangeShifted = _mm_xor_si128(pack.pack, _mm_set1_epi8(0b1000'0000i8));
+	__m128i rangeShifted = _mm_xor_si128(pack.pack, _mm_set1_epi8(static_cast<char>(0b1000'0000)));
 	__m128i sum2 = _mm_sad_epu8(rangeShifted, _mm_setzero_si128());
 	__m128i shuffled = _mm_shuffle_epi32(sum2, 0b01'00'11'10);
 	__m128i sum1 = _mm_add_epi64(sum2, shuffled);
-	return (int)(sum1.m128i_i64[0] - 2048);
+	return (int)(_mm_cvtsi128_si64(sum1) - 2048);
+}
+
+#if WRAPPERSIMD_AVX512
+template <>
+inline int sum<uint8_t, 64>(ValuePack<uint8_t, 64> pack)
+{
+	ValuePack<int64_t, 8> sum8 = _mm512_sad_epu8(pack.pack, _mm512_setzero_si512());
+	return (int)sum(sum8);
+}
+
+template <>
+inline int sum<int8_t, 64>(ValuePack<int8_t, 64> pack)
+{
+	__m512i rangeShifted = _mm512_xor_si512(pack.pack, _mm512_set1_epi8(static_cast<char>(0b1000'0000)));
+	ValuePack<int64_t, 8> sum8 = _mm512_sad_epu8(rangeShifted, _mm512_setzero_si512());
+	return (int)(sum(sum8) - 8192);
+}
+#endif
+
+template <typename ValTy, size_t PackSize>
+inline ValTy hmin(ValuePack<ValTy, PackSize> pack)
+{
+	return detail::HorizontalFold(pack, [](auto a, auto b) { return min(a, b); });
+}
+
+template <typename ValTy, size_t PackSize>
+inline ValTy hmax(ValuePack<ValTy, PackSize> pack)
+{
+	return detail::HorizontalFold(pack, [](auto a, auto b) { return max(a, b); });
+}
+
+// Integer products wrap around in the element type
+template <typename ValTy, size_t PackSize>
+inline ValTy hproduct(ValuePack<ValTy, PackSize> pack)
+{
+	return detail::HorizontalFold(pack, [](auto a, auto b) { return a * b; });
+}
+
+template <typename ValTy, size_t PackSize>
+inline SumType<ValTy> dot(ValuePack<ValTy, PackSize> pack1, ValuePack<ValTy, PackSize> pack2)
+{
+	// 'dp' multiplies, adds and moves the result to the first lane in one instruction, but only within 128 bit lanes
+	if constexpr (std::is_same_v<ValTy, float> && PackSize == 4)
+		return _mm_cvtss_f32(_mm_dp_ps(pack1.pack, pack2.pack, 0xF1));
+	else if constexpr (std::is_same_v<ValTy, float> && PackSize == 8)
+	{
+		__m256 laneDots = _mm256_dp_ps(pack1.pack, pack2.pack, 0xF1);
+		__m128 total = _mm_add_ss(_mm256_castps256_ps128(laneDots), _mm256_extractf128_ps(laneDots, 1));
+		return _mm_cvtss_f32(total);
+	}
+	else if constexpr (std::is_same_v<ValTy, double> && PackSize == 2)
+		return _mm_cvtsd_f64(_mm_dp_pd(pack1.pack, pack2.pack, 0x31));
+	else if constexpr (std::is_floating_point_v<ValTy>)
+		return sum(pack1 * pack2);
+	else if constexpr (std::is_same_v<ValTy, int16_t>)
+		return sum(detail::PairwiseProducts(pack1, pack2));
+	else if constexpr (sizeof(ValTy) >= 4)
+		return sum(pack1 * pack2);
+	else if constexpr (std::is_signed_v<ValTy>)
+	{
+		// Sign extend the even and odd bytes to 16 bits, whose products 'pmaddwd' adds in pairs
+		using I16 = ValuePack<int16_t, PackSize / 2>;
+		I16 a = pack1.pack;
+		I16 b = pack2.pack;
+		ValuePack<int32_t, PackSize / 4> even = detail::PairwiseProducts((a << 8) >> 8, (b << 8) >> 8);
+		ValuePack<int32_t, PackSize / 4> odd = detail::PairwiseProducts(a >> 8, b >> 8);
+		return sum(even + odd);
+	}
+	else if constexpr (sizeof(ValTy) == 1)
+	{
+		// As for int8, zero extending
+		using U16 = ValuePack<uint16_t, PackSize / 2>;
+		U16 a = pack1.pack;
+		U16 b = pack2.pack;
+		U16 lowByte = static_cast<uint16_t>(0x00FF);
+		ValuePack<int32_t, PackSize / 4> even = detail::PairwiseProducts((a & lowByte).template Cast<int16_t>(), (b & lowByte).template Cast<int16_t>());
+		ValuePack<int32_t, PackSize / 4> odd = detail::PairwiseProducts((a >> 8).template Cast<int16_t>(), (b >> 8).template Cast<int16_t>());
+		return sum(even + odd);
+	}
+	else
+	{
+		// uint16 products don't fit 'pmaddwd's signed elements, zero extend the even and odd elements to 32 bits.
+		// The int result wraps, as the scalar sum of products would
+		using U32 = ValuePack<uint32_t, PackSize / 2>;
+		U32 a = pack1.pack;
+		U32 b = pack2.pack;
+		U32 lowHalf = static_cast<uint32_t>(0xFFFF);
+		U32 products = (a & lowHalf) * (b & lowHalf) + (a >> 16) * (b >> 16);
+		return static_cast<SumType<ValTy>>(sum(products));
+	}
+}
+
+// ===== Stream compaction =====
+namespace detail
+{
+	// For each 8 bit mask, the indices of its set bits in increasing order, then those of its clear bits, one per byte.
+	// Shuffling by an entry is a stable partition, which the table-driven paths of 'LeftPack' below preserve
+	inline constexpr std::array<uint64_t, 256> CompressIndices = []
+	{
+		std::array<uint64_t, 256> ret{};
+		for (uint32_t mask = 0; mask < 256; mask++)
+		{
+			uint32_t count = 0;
+			for (uint32_t lane = 0; lane < 8; lane++)
+				if (mask & (1u << lane))
+					ret[mask] |= uint64_t{ lane } << (8 * count++);
+			for (uint32_t lane = 0; lane < 8; lane++)
+				if (!(mask & (1u << lane)))
+					ret[mask] |= uint64_t{ lane } << (8 * count++);
+		}
+		return ret;
+	}();
+
+	// Repeats each of the low 'Lanes' bits, so 64 bit elements can be moved as pairs of 32 bit elements
+	template <size_t Lanes>
+	inline uint32_t DoubleBits(uint64_t bits)
+	{
+		uint32_t ret = 0;
+		for (size_t lane = 0; lane < Lanes; lane++)
+			ret |= static_cast<uint32_t>((bits >> lane) & 1) * (3u << (2 * lane));
+		return ret;
+	}
+
+	// Moves the elements selected by 'bits' to the front of the pack, other lanes are unspecified.
+	// Without AVX-512, 32 and 64 bit elements of 128 and 256 bit packs (AVX2 for 256) are followed by the
+	// unselected elements, in order
+	template <typename ValTy, size_t PackSize>
+	inline ValuePack<ValTy, PackSize> LeftPack(ValuePack<ValTy, PackSize> pack, uint64_t bits)
+	{
+		constexpr size_t bitWidth = sizeof(ValTy) * PackSize * 8;
+		using IntTy =	std::conditional_t<sizeof(ValTy) == 1, int8_t,
+						std::conditional_t<sizeof(ValTy) == 2, int16_t,
+						std::conditional_t<sizeof(ValTy) == 4, int32_t, int64_t>>>;
+		ValuePack<IntTy, PackSize> ints = pack.template Cast<IntTy>();
+
+		if constexpr (WRAPPERSIMD_AVX512 && (bitWidth == 512 || WRAPPERSIMD_AVX512VL) && sizeof(ValTy) >= 4)
+		{
+			// 'vpcompress' does the whole job, below 512 bits with AVX512VL
+			using MaskTy = std::conditional_t<PackSize == 16, __mmask16, __mmask8>;
+			MaskTy k = static_cast<MaskTy>(bits);
+			if constexpr (std::is_floating_point_v<ValTy>)
+			{
+				RETURN_OP(bitWidth, maskz_compress, ValTy, k, pack.pack);
+			}
+			else
+			{
+				RETURN_OP(bitWidth, maskz_compress, IntTy, k, pack.pack);
+			}
+		}
+		else if constexpr (bitWidth == 256 && sizeof(ValTy) >= 4 && WRAPPERSIMD_AVX2)
+		{
+			// Expand the byte indices from the table for 'vpermd'
+			uint32_t bits32 = (sizeof(ValTy) == 8) ? DoubleBits<PackSize>(bits) : static_cast<uint32_t>(bits);
+			__m256i control = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(static_cast<int64_t>(CompressIndices[bits32])));
+			return ValuePack<IntTy, PackSize>(_mm256_permutevar8x32_epi32(ints.pack, control)).template Cast<ValTy>();
+		}
+		else if constexpr (bitWidth > 128)
+		{
+			// Left-pack each half, then write the upper half's survivors over the end of the lower half's
+			constexpr size_t Half = PackSize / 2;
+			ValuePack<ValTy, Half> low = LeftPack(LowHalf(pack), bits & ((uint64_t{ 1 } << Half) - 1));
+			ValuePack<ValTy, Half> high = LeftPack(HighHalf(pack), bits >> Half);
+
+			alignas(bitWidth / 8) ValTy buffer[PackSize];
+			low.Store(buffer);
+			high.StoreUnaligned(buffer + std::popcount(bits & ((uint64_t{ 1 } << Half) - 1)));
+			return ValuePack<ValTy, PackSize>::Load(buffer);
+		}
+		else
+		{
+			// Byte shuffle, with a control built from the table entries of the selected elements
+			__m128i control;
+			if constexpr (sizeof(ValTy) == 1)
+			{
+				// Each half is left-packed by its own table entry, then the gap between the halves is closed
+				// by shuffling the control itself
+				uint64_t lowBits = bits & 0xFF;
+				__m128i halves = _mm_set_epi64x(static_cast<int64_t>(CompressIndices[bits >> 8] + 0x0808'0808'0808'0808),
+					static_cast<int64_t>(CompressIndices[lowBits]));
+				using BytePack = ValuePack<int8_t, 16>;
+				BytePack lanes = BytePack::template Range<0, 1>();
+				int8_t lowCount = static_cast<int8_t>(std::popcount(lowBits));
+				BytePack closeGap = select(lanes >= lowCount, lanes + static_cast<int8_t>(8 - lowCount), lanes);
+				control = _mm_shuffle_epi8(halves, closeGap.pack);
+			}
+			else
+			{
+				uint32_t bits32 = (sizeof(ValTy) == 8) ? DoubleBits<PackSize>(bits) : static_cast<uint32_t>(bits);
+				__m128i indices = _mm_cvtsi64_si128(static_cast<int64_t>(CompressIndices[bits32]));
+				if constexpr (sizeof(ValTy) == 2)
+					control = _mm_add_epi16(_mm_mullo_epi16(_mm_cvtepu8_epi16(indices), _mm_set1_epi16(0x0202)), _mm_set1_epi16(0x0100));
+				else
+					control = _mm_add_epi32(_mm_mullo_epi32(_mm_cvtepu8_epi32(indices), _mm_set1_epi32(0x0404'0404)), _mm_set1_epi32(0x0302'0100));
+			}
+			return ValuePack<IntTy, PackSize>(_mm_shuffle_epi8(ints.pack, control)).template Cast<ValTy>();
+		}
+	}
+}
+
+// Moves the elements selected by 'mask' to the front of the pack, keeping their order, and returns them with
+// their count. Lanes past the count are unspecified.
+//	auto [positives, count] = compress(pack, pack > 0);
+template <typename ValTy, size_t PackSize>
+inline std::pair<ValuePack<ValTy, PackSize>, size_t> compress(ValuePack<ValTy, PackSize> pack, BoolPack<PackSize, sizeof(ValTy)> mask)
+{
+	uint64_t bits = mask.ToBits();
+	return { detail::LeftPack(pack, bits), static_cast<size_t>(std::popcount(bits)) };
+}
+
+// ===== Sorting =====
+// Merges two sorted packs, returning the lower and upper halves of the result, each sorted
+template <typename ValTy, size_t PackSize>
+inline std::pair<ValuePack<ValTy, PackSize>, ValuePack<ValTy, PackSize>> merge(ValuePack<ValTy, PackSize> a, ValuePack<ValTy, PackSize> b)
+{
+	using Pack = ValuePack<ValTy, PackSize>;
+
+	// Against 'b' reversed, the lane-wise minimums are the lower half and the maximums the upper half.
+	// Both are bitonic, so each only needs the final merging stages of the network
+	Pack reversed = b.Reverse();
+	Pack lower = min(a, reversed);
+	Pack upper = max(a, reversed);
+	return { lower.template BitonicStages<PackSize, PackSize / 2>(), upper.template BitonicStages<PackSize, PackSize / 2>() };
 }
 
 // Special
@@ -933,6 +3227,7 @@ inline BoolPack<PackSize, sizeof(ValTy)> isfinite(ValuePack<ValTy, PackSize> pac
 	return (pack < Inf) && (pack > -Inf);
 }
 
+#if WRAPPERSIMD_VEX
 inline ValuePack<int64_t, 4> exponent(ValuePack<double, 4> pack)
 {
 	ValuePack<uint64_t, 4> punn = pack.Cast<uint64_t>();
@@ -943,18 +3238,16 @@ inline ValuePack<int64_t, 4> exponent(ValuePack<double, 4> pack)
 inline ValuePack<double, 4> next(ValuePack<double, 4> pack)
 {
 	// This function is broken with input -0.0
-	ValuePack<int64_t, 4> incr = ((pack >= 0).Cast<int64_t>() & 2) - 1;
-	ValuePack<int64_t, 4> isFinite = isfinite(pack).Cast<int64_t>();
-	incr &= isFinite;
+	ValuePack<int64_t, 4> incr = select(pack >= 0, ValuePack<int64_t, 4>(1), ValuePack<int64_t, 4>(-1));
+	incr = select(isfinite(pack), incr, ValuePack<int64_t, 4>(0));
 
 	return (pack.Cast<int64_t>() + incr).Cast<double>();
 }
 
 inline ValuePack<double, 4> prev(ValuePack<double, 4> pack)
 {
-	ValuePack<int64_t, 4> incr = ((pack <= 0).Cast<int64_t>() & 2) - 1;
-	ValuePack<int64_t, 4> isFinite = isfinite(pack).Cast<int64_t>();
-	incr &= isFinite;
+	ValuePack<int64_t, 4> incr = select(pack <= 0, ValuePack<int64_t, 4>(1), ValuePack<int64_t, 4>(-1));
+	incr = select(isfinite(pack), incr, ValuePack<int64_t, 4>(0));
 
 	ValuePack<int64_t, 4> res = pack.Cast<int64_t>() + incr;
 	ValuePack<int64_t, 4> signFlipMask = (pack == 0).Cast<int64_t>() & INT64_MIN;
@@ -962,12 +3255,20 @@ inline ValuePack<double, 4> prev(ValuePack<double, 4> pack)
 
 	return res.Cast<double>();
 }
+#endif
 
 template <ComparisonOperator op, typename ValTy, size_t PackSize>
 inline BoolPack<PackSize, sizeof(ValTy)> cmp(ValuePack<ValTy, PackSize> pack1, ValuePack<ValTy, PackSize> pack2)
 {
 	static_assert(std::is_floating_point_v<ValTy>, "Function cmp only supports floating point types.");
-	RETURN_OP(pack1.is256, cmp, ValTy, pack1.pack, pack2.pack, op);
+	if constexpr (pack1.is512)
+	{
+		RETURN_MASK_OP(cmp, ValTy, pack1.pack, pack2.pack, op);
+	}
+	else
+	{
+		RETURN_OP(pack1.bitWidth, cmp, ValTy, pack1.pack, pack2.pack, op);
+	}
 }
 
 // === Ostream operators ===
@@ -1000,6 +3301,8 @@ std::ostream& operator<<(std::ostream& os, const BoolPack<NumElem, ElemSize>& pa
 	return os;
 }
 
+} // namespace WRAPPERSIMD_TARGET
+
 // === Formatter ===
 template <typename ValTy, size_t PackSize>
 struct std::formatter<ValuePack<ValTy, PackSize>> : std::formatter<const char*>
@@ -1019,11 +3322,13 @@ public:
 	}
 };
 
+inline namespace WRAPPERSIMD_TARGET
+{
 // === Deduction Guides ===
 template <typename FirstTy, IsValTy<FirstTy>... OtherTy> ValuePack(FirstTy, OtherTy...)
 -> ValuePack<FirstTy, sizeof...(OtherTy) + 1>;
 
-// Guides for __m128d, __m256, and __m256d
+// Guides for __m128d, __m256, __m256d, __m512 and __m512d
 // Guides cannot be provided for __m128, __m128i and __m256i as they contain unions, and the desired type is therefore unknowable
 ValuePack(__m128d)
 ->ValuePack<double, 2>;
@@ -1032,4 +3337,31 @@ ValuePack(__m256)
 ->ValuePack<float, 8>;
 
 ValuePack(__m256d)
-->ValuePack<double, 4>;
\ No newline at end of file
+->ValuePack<double, 4>;
+
+#if WRAPPERSIMD_AVX512
+ValuePack(__m512)
+->ValuePack<float, 16>;
+
+ValuePack(__m512d)
+->ValuePack<double, 8>;
+#endif
+
+// === Native width ===
+// Widest pack the current translation unit is compiled for
+#if WRAPPERSIMD_AVX512
+inline constexpr size_t NativeBytes = 64;
+#elif WRAPPERSIMD_AVX2
+inline constexpr size_t NativeBytes = 32;
+#else
+inline constexpr size_t NativeBytes = 16;
+#endif
+
+template <typename ValTy>
+using NativePack = ValuePack<ValTy, NativeBytes / sizeof(ValTy)>;
+} // namespace WRAPPERSIMD_TARGET
+
+#if !WRAPPERSIMD_SVML
+#include "PackMath.h"
+#endif
+#include "WidePack.h"
@@ -0,0 +1,439 @@
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "ValuePack.h"
+
+// Packs wider than one register, such as ValuePack<float, 32> or ValuePack<double, 16>. They hold an array of native
+// packs ('parts') and apply every operator, comparison and math function to each part in turn, so the parts are
+// independent dependency chains the CPU can execute in parallel. Latency bound loops (FMA chains, reductions) can then be
+// unrolled by just widening the pack:
+//
+//	ValuePack<float, 32> acc = 0.0f;	// Four independent accumulators with AVX2
+//	for (size_t i = 0; i < n; i += acc.Size())
+//		acc = fma(ValuePack<float, 32>::Load(a + i), ValuePack<float, 32>::Load(b + i), acc);
+//	float total = sum(acc);
+//
+// Reductions first combine the parts element-wise, then reduce one native pack.
+// The parts are always processed with compile-time folds, loops over them are not reliably unrolled and would keep the
+// parts in memory.
+
+inline namespace WRAPPERSIMD_TARGET
+{
+// Widest single register pack. Without AVX there are no 256 bit registers
+inline constexpr size_t MaxPackBytes = WRAPPERSIMD_AVX512 ? 64 : WRAPPERSIMD_VEX ? 32 : 16;
+
+template <typename ValTy, size_t PackSize>
+concept WidePackSize = sizeof(ValTy) * PackSize > MaxPackBytes;
+
+namespace detail
+{
+	// 'op(...op(op(parts[0], parts[1]), parts[2])..., parts[N - 1])'
+	template <typename Part, size_t N, typename Op>
+	inline Part FoldParts(const std::array<Part, N>& parts, Op&& op)
+	{
+		return [&]<size_t... Is>(std::index_sequence<Is...>)
+		{
+			Part acc = parts[0];
+			((acc = op(acc, parts[Is + 1])), ...);
+			return acc;
+		}(std::make_index_sequence<N - 1>());
+	}
+}
+
+template <size_t NumElem, size_t ElemSize>
+	requires (NumElem * ElemSize > MaxPackBytes)
+class BoolPack<NumElem, ElemSize>
+{
+public:
+	using Part = BoolPack<NativeBytes / ElemSize, ElemSize>;
+	static constexpr size_t PartSize = NativeBytes / ElemSize;
+	static constexpr size_t NumParts = NumElem / PartSize;
+	static_assert(NumElem % PartSize == 0, "Wide BoolPack must be a whole number of native packs");
+
+	BoolPack(const std::array<Part, NumParts>& parts_)
+		: parts(parts_) {}
+
+	// Builds each part as 'func(partIdx)'
+	template <typename Func>
+	static BoolPack FromParts(Func&& func)
+	{
+		return [&]<size_t... Is>(std::index_sequence<Is...>)
+		{
+			return BoolPack(std::array<Part, NumParts>{ func(Is)... });
+		}(std::make_index_sequence<NumParts>());
+	}
+
+	bool operator[](size_t idx) const
+	{
+#ifdef _DEBUG
+		assert(idx < NumElem);
+#endif
+		return parts[idx / PartSize][idx % PartSize];
+	}
+
+	inline operator bool() const
+	{
+		return All();
+	}
+
+	inline bool All() const
+	{
+		return [&]<size_t... Is>(std::index_sequence<Is...>) { return (... && parts[Is].All()); }(std::make_index_sequence<NumParts>());
+	}
+
+	inline bool None() const
+	{
+		return [&]<size_t... Is>(std::index_sequence<Is...>) { return (... && parts[Is].None()); }(std::make_index_sequence<NumParts>());
+	}
+
+	inline bool Any() const
+	{
+		return !None();
+	}
+
+	// One bit per element, only for packs of up to 64 elements
+	inline uint64_t ToBits() const
+	{
+		static_assert(NumElem <= 64, "ToBits needs at most 64 elements");
+		return [&]<size_t... Is>(std::index_sequence<Is...>)
+		{
+			return (... | (uint64_t{ parts[Is].ToBits() } << (Is * PartSize)));
+		}(std::make_index_sequence<NumParts>());
+	}
+
+	inline BoolPack operator!() const
+	{
+		return FromParts([&](size_t i) { return !parts[i]; });
+	}
+
+	inline BoolPack operator||(BoolPack other) const
+	{
+		return FromParts([&](size_t i) { return Part(parts[i]) || other.parts[i]; });
+	}
+
+	inline BoolPack operator&&(BoolPack other) const
+	{
+		return FromParts([&](size_t i) { return Part(parts[i]) && other.parts[i]; });
+	}
+
+	std::array<Part, NumParts> parts;
+};
+
+#define ADD_WIDE_OP_METHOD(op)\
+inline ValuePack operator op (ValuePack other) const\
+{\
+	return FromParts([&](size_t i) { return parts[i] op other.parts[i]; });\
+}\
+inline ValuePack& operator op##=(ValuePack other)\
+{\
+	return *this = (*this) op other;\
+}
+
+#define ADD_WIDE_SCALAR_METHOD(op)\
+inline ValuePack operator op (ValTy x) const\
+{\
+	return (*this) op ValuePack(x);\
+}\
+inline ValuePack& operator op##=(ValTy x)\
+{\
+	return *this = (*this) op ValuePack(x);\
+}
+
+#define ADD_WIDE_COMP_OP(op)\
+inline BoolPack<PackSize, sizeof(ValTy)> operator op (ValuePack other) const\
+{\
+	return BoolPack<PackSize, sizeof(ValTy)>::FromParts([&](size_t i) { return Part(parts[i]) op other.parts[i]; });\
+}\
+inline BoolPack<PackSize, sizeof(ValTy)> operator op (ValTy x) const\
+{\
+	return (*this) op ValuePack(x);\
+}
+
+template <typename ValTy, size_t PackSize>
+	requires WidePackSize<ValTy, PackSize>
+class ValuePack<ValTy, PackSize>
+{
+public:
+	using Part = NativePack<ValTy>;
+	static constexpr size_t PartSize = Part::Size();
+	static constexpr size_t NumParts = PackSize / PartSize;
+	static_assert(PackSize % PartSize == 0, "Wide ValuePack must be a whole number of native packs");
+
+	// == Constructors ==
+	ValuePack() = default;
+
+	ValuePack(const std::array<Part, NumParts>& parts_)
+		: parts(parts_) {}
+
+	template <IsValTy<ValTy>... Vals>
+	ValuePack(ValTy first, Vals... others)
+	{
+		static_assert(sizeof...(others) == PackSize - 1, "Incorrect number of initializer values for ValuePack");
+		alignas(NativeBytes) ValTy ordered[] = { first, static_cast<ValTy>(others)... };
+		*this = Load(ordered);
+	}
+
+	ValuePack(ValTy x)
+		: ValuePack(FromParts([&](size_t) { return Part(x); })) {}
+
+	static ValuePack RepVal(ValTy x)
+	{
+		return ValuePack(x);
+	}
+
+	// Builds each part as 'func(partIdx)'
+	template <typename Func>
+	static ValuePack FromParts(Func&& func)
+	{
+		return [&]<size_t... Is>(std::index_sequence<Is...>)
+		{
+			return ValuePack(std::array<Part, NumParts>{ func(Is)... });
+		}(std::make_index_sequence<NumParts>());
+	}
+
+	// == Memory ==
+	// 'ptr' must be aligned to the size of a native pack
+	static ValuePack Load(const ValTy* ptr)
+	{
+		return FromParts([&](size_t i) { return Part::Load(ptr + i * PartSize); });
+	}
+
+	static ValuePack LoadUnaligned(const ValTy* ptr)
+	{
+		return FromParts([&](size_t i) { return Part::LoadUnaligned(ptr + i * PartSize); });
+	}
+
+	// Loads the first 'n' elements and zeroes the rest, without touching memory past 'ptr + n'
+	static ValuePack LoadPartial(const ValTy* ptr, size_t n)
+	{
+		return FromParts([&](size_t i) { return n > i * PartSize ? Part::LoadPartial(ptr + i * PartSize, n - i * PartSize) : Part(ValTy{}); });
+	}
+
+	// 'ptr' must be aligned to the size of a native pack
+	void Store(ValTy* ptr) const
+	{
+		ForEachPart([&](size_t i) { parts[i].Store(ptr + i * PartSize); });
+	}
+
+	void StoreUnaligned(ValTy* ptr) const
+	{
+		ForEachPart([&](size_t i) { parts[i].StoreUnaligned(ptr + i * PartSize); });
+	}
+
+	// Stores the first 'n' elements, without touching memory past 'ptr + n'
+	void StorePartial(ValTy* ptr, size_t n) const
+	{
+		ForEachPart([&](size_t i) { if (n > i * PartSize) parts[i].StorePartial(ptr + i * PartSize, n - i * PartSize); });
+	}
+
+	// == Special members ==
+	static consteval size_t Size()
+	{
+		return PackSize;
+	}
+
+	typename Part::ElemRef& operator[](size_t idx) const
+	{
+#ifdef _DEBUG
+		assert(idx < PackSize);
+#endif
+		return parts[idx / PartSize][idx % PartSize];
+	}
+
+	// == Operators ==
+	ADD_WIDE_OP_METHOD(+);
+	ADD_WIDE_OP_METHOD(-);
+	ADD_WIDE_OP_METHOD(*);
+	ADD_WIDE_OP_METHOD(/);
+	ADD_WIDE_OP_METHOD(%);
+	ADD_WIDE_OP_METHOD(&);
+	ADD_WIDE_OP_METHOD(|);
+	ADD_WIDE_OP_METHOD(^);
+
+	ADD_WIDE_SCALAR_METHOD(+);
+	ADD_WIDE_SCALAR_METHOD(-);
+	ADD_WIDE_SCALAR_METHOD(*);
+	ADD_WIDE_SCALAR_METHOD(/);
+	ADD_WIDE_SCALAR_METHOD(%);
+	ADD_WIDE_SCALAR_METHOD(&);
+	ADD_WIDE_SCALAR_METHOD(|);
+	ADD_WIDE_SCALAR_METHOD(^);
+
+	ValuePack operator-() const
+	{
+		return FromParts([&](size_t i) { return -parts[i]; });
+	}
+
+	// === Comparison operators ===
+	ADD_WIDE_COMP_OP(==);
+	ADD_WIDE_COMP_OP(>);
+	ADD_WIDE_COMP_OP(<);
+	ADD_WIDE_COMP_OP(>=);
+	ADD_WIDE_COMP_OP(<=);
+
+	// Shifting
+	ADD_WIDE_OP_METHOD(<<);
+	ADD_WIDE_OP_METHOD(>>);
+
+	inline ValuePack operator<<(int x) const
+	{
+		return FromParts([&](size_t i) { return parts[i] << x; });
+	}
+
+	inline ValuePack operator>>(int x) const
+	{
+		return FromParts([&](size_t i) { return parts[i] >> x; });
+	}
+
+	inline ValuePack& operator<<=(int x)
+	{
+		return *this = (*this) << x;
+	}
+
+	inline ValuePack& operator>>=(int x)
+	{
+		return *this = (*this) >> x;
+	}
+
+	std::array<Part, NumParts> parts;
+
+protected:
+	template <typename Func>
+	void ForEachPart(Func&& func) const
+	{
+		[&]<size_t... Is>(std::index_sequence<Is...>) { (func(Is), ...); }(std::make_index_sequence<NumParts>());
+	}
+};
+
+// ===== Free functions =====
+#define ADD_WIDE_FREE_FUNC(funcName)\
+template <typename ValTy, size_t PackSize> requires WidePackSize<ValTy, PackSize>\
+inline ValuePack<ValTy, PackSize> funcName (ValuePack<ValTy, PackSize> pack)\
+{\
+	return ValuePack<ValTy, PackSize>::FromParts([&](size_t i) { return funcName(pack.parts[i]); });\
+}
+
+#define ADD_WIDE_FREE_FUNC_2ARG(funcName)\
+template <typename ValTy, size_t PackSize> requires WidePackSize<ValTy, PackSize>\
+inline ValuePack<ValTy, PackSize> funcName (ValuePack<ValTy, PackSize> pack1, ValuePack<ValTy, PackSize> pack2)\
+{\
+	return ValuePack<ValTy, PackSize>::FromParts([&](size_t i) { return funcName(pack1.parts[i], pack2.parts[i]); });\
+}
+
+#define ADD_WIDE_FREE_FUNC_3ARG(funcName)\
+template <typename ValTy, size_t PackSize> requires WidePackSize<ValTy, PackSize>\
+inline ValuePack<ValTy, PackSize> funcName (ValuePack<ValTy, PackSize> a, ValuePack<ValTy, PackSize> b, ValuePack<ValTy, PackSize> c)\
+{\
+	return ValuePack<ValTy, PackSize>::FromParts([&](size_t i) { return funcName(a.parts[i], b.parts[i], c.parts[i]); });\
+}
+
+// Trigonometric
+ADD_WIDE_FREE_FUNC(sin);
+ADD_WIDE_FREE_FUNC(cos);
+ADD_WIDE_FREE_FUNC(tan);
+ADD_WIDE_FREE_FUNC(asin);
+ADD_WIDE_FREE_FUNC(acos);
+ADD_WIDE_FREE_FUNC(atan);
+ADD_WIDE_FREE_FUNC_2ARG(atan2);
+ADD_WIDE_FREE_FUNC(sinh);
+ADD_WIDE_FREE_FUNC(cosh);
+ADD_WIDE_FREE_FUNC(tanh);
+ADD_WIDE_FREE_FUNC(asinh);
+ADD_WIDE_FREE_FUNC(acosh);
+ADD_WIDE_FREE_FUNC(atanh);
+
+// Exponential, logarithmic and powers
+ADD_WIDE_FREE_FUNC(exp);
+ADD_WIDE_FREE_FUNC(log);
+ADD_WIDE_FREE_FUNC(log2);
+ADD_WIDE_FREE_FUNC(log10);
+ADD_WIDE_FREE_FUNC(sqrt);
+ADD_WIDE_FREE_FUNC(cbrt);
+ADD_WIDE_FREE_FUNC(invsqrt);
+ADD_WIDE_FREE_FUNC(invsqrt_approx);
+ADD_WIDE_FREE_FUNC(invcbrt);
+ADD_WIDE_FREE_FUNC_2ARG(pow);
+ADD_WIDE_FREE_FUNC(erf);
+
+// Rounding
+ADD_WIDE_FREE_FUNC(floor);
+ADD_WIDE_FREE_FUNC(round);
+ADD_WIDE_FREE_FUNC(ceil);
+ADD_WIDE_FREE_FUNC(trunc);
+ADD_WIDE_FREE_FUNC(rint);
+
+// Arithmetic
+ADD_WIDE_FREE_FUNC(abs);
+ADD_WIDE_FREE_FUNC_2ARG(min);
+ADD_WIDE_FREE_FUNC_2ARG(max);
+ADD_WIDE_FREE_FUNC_2ARG(avg);
+ADD_WIDE_FREE_FUNC_2ARG(adds);
+ADD_WIDE_FREE_FUNC_2ARG(subs);
+
+// Fused multiply-add
+ADD_WIDE_FREE_FUNC_3ARG(fma);
+ADD_WIDE_FREE_FUNC_3ARG(fms);
+ADD_WIDE_FREE_FUNC_3ARG(fnma);
+ADD_WIDE_FREE_FUNC_3ARG(fnms);
+ADD_WIDE_FREE_FUNC_3ARG(fmaddsub);
+ADD_WIDE_FREE_FUNC_3ARG(fmsubadd);
+
+template <typename ValTy, size_t PackSize> requires WidePackSize<ValTy, PackSize>
+inline ValuePack<ValTy, PackSize> select(BoolPack<PackSize, sizeof(ValTy)> mask, ValuePack<ValTy, PackSize> a, ValuePack<ValTy, PackSize> b)
+{
+	return ValuePack<ValTy, PackSize>::FromParts([&](size_t i) { return select(mask.parts[i], a.parts[i], b.parts[i]); });
+}
+
+// ===== Horizontal reductions =====
+template <typename ValTy, size_t PackSize> requires WidePackSize<ValTy, PackSize>
+inline SumType<ValTy> sum(ValuePack<ValTy, PackSize> pack)
+{
+	// Narrow integers are widened by 'sum', adding the parts first could overflow
+	if constexpr (std::is_integral_v<ValTy> && sizeof(ValTy) < 4)
+		return [&]<size_t... Is>(std::index_sequence<Is...>) { return (... + sum(pack.parts[Is])); }(std::make_index_sequence<pack.NumParts>());
+	else
+		return sum(detail::FoldParts(pack.parts, [](auto a, auto b) { return a + b; }));
+}
+
+template <typename ValTy, size_t PackSize> requires WidePackSize<ValTy, PackSize>
+inline ValTy hmin(ValuePack<ValTy, PackSize> pack)
+{
+	return hmin(detail::FoldParts(pack.parts, [](auto a, auto b) { return min(a, b); }));
+}
+
+template <typename ValTy, size_t PackSize> requires WidePackSize<ValTy, PackSize>
+inline ValTy hmax(ValuePack<ValTy, PackSize> pack)
+{
+	return hmax(detail::FoldParts(pack.parts, [](auto a, auto b) { return max(a, b); }));
+}
+
+// Integer products wrap around in the element type
+template <typename ValTy, size_t PackSize> requires WidePackSize<ValTy, PackSize>
+inline ValTy hproduct(ValuePack<ValTy, PackSize> pack)
+{
+	return hproduct(detail::FoldParts(pack.parts, [](auto a, auto b) { return a * b; }));
+}
+
+template <typename ValTy, size_t PackSize> requires WidePackSize<ValTy, PackSize>
+inline SumType<ValTy> dot(ValuePack<ValTy, PackSize> pack1, ValuePack<ValTy, PackSize> pack2)
+{
+	if constexpr (std::is_floating_point_v<ValTy>)
+	{
+		// Separate products per part, then one chain of fused multiply-adds
+		return [&]<size_t... Is>(std::index_sequence<Is...>)
+		{
+			auto acc = pack1.parts[0] * pack2.parts[0];
+			((acc = fma(pack1.parts[Is + 1], pack2.parts[Is + 1], acc)), ...);
+			return sum(acc);
+		}(std::make_index_sequence<pack1.NumParts - 1>());
+	}
+	else
+	{
+		return [&]<size_t... Is>(std::index_sequence<Is...>) { return (... + dot(pack1.parts[Is], pack2.parts[Is])); }(std::make_index_sequence<pack1.NumParts>());
+	}
+}
+} // namespace WRAPPERSIMD_TARGET